@@ -9,6 +9,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <assert.h>
 #include <TString.h>
 #include <TTree.h>
@@ -27,6 +28,8 @@
 #include "AnalysisTools/TreeReader/interface/CMSTopReader.h"
 #include "AnalysisTools/TreeReader/interface/CORRALReader.h"
 #include "AnalysisBase/TreeAnalyzer/interface/JetCorrections.h"
+#include "AnalysisTools/Utilities/interface/EventIndex.h"
+#include "AnalysisTools/Utilities/interface/LumiMask.h"
 
 
 namespace ucsbsusy {
@@ -35,7 +38,7 @@ public:
     
   public:
     BaseTreeAnalyzer(TString fileName, TString treeName, bool isMCTree = false,cfgSet::ConfigSet *pars = 0, TString readOption = "READ");
-    virtual ~BaseTreeAnalyzer() {};
+    virtual ~BaseTreeAnalyzer();
 
 
     // Load a variable type to be read from the TTree
@@ -62,10 +65,60 @@ public:
     // Base function that runs the standard process
     virtual void analyze(int reportFrequency = 10000, int numEvents = -1);
 
+    // Only process the entries [firstEntry, lastEntry) of the tree (used by ParallelTreeAnalyzer)
+    void setEntryRange(int firstEntry, int lastEntry = -1) { reader.setEntryRange(firstEntry,lastEntry); }
+
+    // Read ahead and unzip prefetchDepth clusters of the loaded branches in the background (see TreeReader)
+    void setPrefetch(int prefetchDepth = 2) { reader.setPrefetch(prefetchDepth); }
+
+    // Only process the entries passing a cheap selection on the tree branches, cached between jobs (see TreeReader)
+    void setPreselection(TString selection, TString cacheDir = ".preselection") { reader.setPreselection(selection,cacheDir); }
+
+    // Record which of the loaded branches are used and print a suggested loadVariables() at the end of the job
+    // Branches only count as used by the analysis code when read through access()
+    void setProfiling(bool profile = true) { reader.setProfiling(profile); }
+    virtual void printLoadSuggestion(std::ostream& os = std::clog);
+
+    // Time the stages of the event loop (reading, each reader, processVariables, runEvent) and the throughput
+    // The summary is printed at the end of analyze() and written to summaryFile if given (.json or .root)
+    void setTiming(bool timing = true, TString summaryFile = "", int reportInterval = 1000)
+      { reader.setTiming(timing,reportInterval); timingFile_ = summaryFile; }
+
+    // Only read a branch when it is first accessed in the event (see TreeReader::setLazyLoading)
+    // Branches can be accessed in passPreselection() with access(), all others are read after it passes
+    void setLazyLoading(bool lazy = true) { reader.setLazyLoading(lazy); }
+    template<typename varType>
+    varType& access(varType * var) { return reader.access(var); }
+
+    // Only process the events in the certified lumi sections of a CMS JSON file, and/or skip the events whose
+    // (run, lumi, event) was already processed. Checked before passPreselection(), with lazy loading only the
+    // run, lumi and event branches are read for the rejected events. Both need the event info to be loaded
+    void setLumiMask(TString jsonFile);
+    void setDuplicateRejection(bool reject = true) { rejectDuplicates_ = reject; }
+    bool isRejectingDuplicates() const { return rejectDuplicates_; }
+    // The events seen so far, e.g. add the index of another stream with read() to reject its events
+    EventIndex& getSeenEvents() { return seenEvents_; }
+    bool passEventFilter();
+
     // Sub processes that can be overloaded
     virtual void loadVariables();       //load variables
+    virtual bool passPreselection() { return true; } //cheap early cut, before the readers are refreshed
     virtual void processVariables();    //event processing
     virtual void runEvent() = 0;        //analysis code
+    void         endTiming();           //print and write the timing summary, called at the end of analyze()
+
+    // Metadata written with the input tree (see TreeReader::getMetadata)
+    const TreeMetadata& getInputMetadata() { return reader.getMetadata(); }
+    // Start the metadata of an output: source files, configuration hash, and process and cross section of the input
+    // Fields that are already set are kept
+    void         initMetadata(TreeMetadata& metadata);
+    // Count a processed input event with its weight (wgtXSec), called by the copiers for every event read
+    // With a preselection, only the preselected events are read and initMetadata counts the whole input instead
+    void         countEvent(TreeMetadata& metadata);
+    // Count every event of the input with its weight, reading only the weight branch
+    void         countInput(TreeMetadata& metadata);
+    // Hash of the object configurations, e.g. to notice when an output was made with different settings
+    static TString configHash(const cfgSet::ConfigSet& config);
 
     //--------------------------------------------------------------------------------------------------
     // Standard information
@@ -74,6 +127,8 @@ public:
     int  getEntries()     const { return reader.getEntries(); }
     bool isMC()           const { return isMC_;               }
     bool isLoaded()       const { return isLoaded_;           }
+    // Event scalars as bound to the tree, no per-event copy (see EventInfoReader::HEADERONLY)
+    const EventHeader& header() const { return evtInfoReader.header(); }
 
 
     //--------------------------------------------------------------------------------------------------
@@ -83,6 +138,12 @@ public:
     bool             isLoaded_;
     bool             isProcessed_;
     TreeReader       reader;        // default reader
+    TString          timingFile_;   // where to write the timing summary
+    std::unique_ptr<LumiMask> lumiMask_;
+    bool             rejectDuplicates_;
+    EventIndex       seenEvents_;
+    Long64_t         nMasked_;
+    Long64_t         nDuplicates_;
   public:
     EventInfoReader   evtInfoReader         ;
     JetReader         ak4Reader             ;
@@ -122,6 +183,8 @@ public:
     //--------------------------------------------------------------------------------------------------
     // Stored collections
     //--------------------------------------------------------------------------------------------------
+    // Point into the reader collections (event arena) but stay heap vectors: they are cleared and keep
+    // their capacity, and the analyses pass them on as std::vector<X*>
     MomentumF*                 met     ;
     MomentumF*                 genmet  ;
     bool goodvertex;
@@ -133,6 +196,9 @@ public:
     std::vector<RecoJetF*>     jets            ;
     std::vector<RecoJetF*>     bJets   ;
     std::vector<RecoJetF*>     nonBJets;
+    std::vector<size16>        jetIndices ; //columnar mode (JetReader::FILLCOLUMNS without FILLOBJ), index into defaultJets->columns
+    std::vector<size16>        bJetIndices;
+    std::vector<size16>        nonBJetIndices;
     std::vector<GenParticleF*> genParts;
     std::vector<CMSTopF*>      cttTops;
     std::vector<TauF*>         HPSTaus;
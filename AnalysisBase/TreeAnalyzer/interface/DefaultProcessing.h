@@ -4,6 +4,9 @@
 
 #include "AnalysisBase/TreeAnalyzer/interface/ConfigurationBase.h"
 #include "AnalysisTools/DataFormats/interface/Jet.h"
+#include "AnalysisTools/TreeReader/interface/JetReader.h"
+#include "AnalysisTools/TreeReader/interface/PFCandidateReader.h"
+#include "AnalysisTools/TreeReader/interface/EventArena.h"
 
 namespace cfgSet{
   bool isSelGenJet   (const ucsbsusy::GenJetF& jet, const JetConfig& conf     );
@@ -12,15 +15,23 @@ namespace cfgSet{
   bool isSelMuon(const ucsbsusy::MuonF& muon, const LeptonConfig& conf);
   bool isSelTrack(const ucsbsusy::PFCandidateF& track, const TrackConfig& conf);
   bool isSelPhoton(const ucsbsusy::PhotonF& pho, const PhotonConfig& conf       );
-  void selectLeptons(std::vector<ucsbsusy::LeptonF*>& selectedLeptons  ,std::vector<ucsbsusy::LeptonF*> allLeptons, const LeptonConfig& conf);
-  void selectTracks(std::vector<ucsbsusy::PFCandidateF*>& selectedTracks, ucsbsusy::PFCandidateFCollection& allTracks, const TrackConfig& conf);
+  void selectLeptons(std::vector<ucsbsusy::LeptonF*>& selectedLeptons  ,const std::vector<ucsbsusy::LeptonF*>& allLeptons, const LeptonConfig& conf);
+  void selectTracks(std::vector<ucsbsusy::PFCandidateF*>& selectedTracks, ucsbsusy::PFCandidateFArenaCollection& allTracks, const TrackConfig& conf);
   void selectPhotons(std::vector<ucsbsusy::PhotonF*>& selectedPhotons, ucsbsusy::PhotonFCollection& allPhotons, const PhotonConfig& conf);
 
   void selectJets(std::vector<ucsbsusy::RecoJetF*>& jets, std::vector<ucsbsusy::RecoJetF*>* bJets, std::vector<ucsbsusy::RecoJetF*>* nonBJets,
-      ucsbsusy::RecoJetFCollection& allJets, const std::vector<ucsbsusy::LeptonF*>* selectedLeptons, const std::vector<ucsbsusy::LeptonF*>* vetoedLeptons, const std::vector<ucsbsusy::PhotonF*>* selectedPhotons, const JetConfig&  conf);
+      ucsbsusy::RecoJetFArenaCollection& allJets, const std::vector<ucsbsusy::LeptonF*>* selectedLeptons, const std::vector<ucsbsusy::LeptonF*>* vetoedLeptons, const std::vector<ucsbsusy::PhotonF*>* selectedPhotons, const JetConfig&  conf, ucsbsusy::EventArena * arena = 0);
+
+  //The optional arena (TreeReader::getArena()) is used for the scratch memory of the selection
+  //Columnar versions working on the JetReader::columns view, jets are returned as indices (in pt order)
+  bool isSelBJet   (const ucsbsusy::JetColumns& columns, const unsigned int iJ, const JetConfig& conf, const float minCSV = -10000);
+  void selectJets(std::vector<ucsbsusy::size16>& jets, std::vector<ucsbsusy::size16>* bJets, std::vector<ucsbsusy::size16>* nonBJets,
+      const ucsbsusy::JetColumns& allJets, const std::vector<ucsbsusy::LeptonF*>* selectedLeptons, const std::vector<ucsbsusy::LeptonF*>* vetoedLeptons, const std::vector<ucsbsusy::PhotonF*>* selectedPhotons, const JetConfig&  conf, ucsbsusy::EventArena * arena = 0);
+  double ht    (const ucsbsusy::JetColumns& columns, const std::vector<ucsbsusy::size16>& jets);
+  int    nBJets(const ucsbsusy::JetColumns& columns, const std::vector<ucsbsusy::size16>& jets, const JetConfig& conf, const float minCSV = -10000);
 
   double adHocPUCorr(double pt,double eta,double area, double rho);
-  void  applyAdHocPUCorr(ucsbsusy::RecoJetFCollection& jets, const std::vector<float>& jetAreas, const float rho);
+  void  applyAdHocPUCorr(ucsbsusy::RecoJetFArenaCollection& jets, const std::vector<float>& jetAreas, const float rho);
 
 //  void processMET(ucsbsusy::MomentumF& met, const std::vector<ucsbsusy::LeptonF*>* selectedLeptons, const std::vector<ucsbsusy::PhotonF*>* selectedPhotons, const METConfig& conf);
 
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------------------
+//
+// IncrementalSkimmer
+//
+// Skims a list of input files into one output, keeping one output fragment per input file in
+// fragmentDir together with a manifest of the input fingerprints (see FileFingerprint) and the
+// configuration key. A rerun only processes the inputs that are new or changed, or all of them if the
+// configuration key changed, drops the fragments of removed inputs and merges the fragments again
+// (in input order, with NtupleMerger, so the metadata of the fragments is summed).
+//
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISBASE_TREEANALYZER_INCREMENTALSKIMMER_H
+#define ANALYSISBASE_TREEANALYZER_INCREMENTALSKIMMER_H
+
+#include <map>
+#include <vector>
+#include <TString.h>
+
+#include "AnalysisBase/TreeAnalyzer/interface/ParallelTreeAnalyzer.h"
+
+namespace ucsbsusy {
+
+  class IncrementalSkimmer {
+  public:
+    typedef ParallelTreeAnalyzer::Factory Factory;
+
+    // fileName is anything TreeReader reads as a list of files, outTreeName the name of the tree the analyzers write
+    // configKey has to change whenever the skim does (selection, branches, configuration), e.g. BaseTreeAnalyzer::configHash of the
+    // configuration plus the skim parameters
+    IncrementalSkimmer(TString fileName, TString treeName, TString outFileName, TString outTreeName, TString fragmentDir,
+                       TString configKey, Factory factory, int nThreads = 0);
+    virtual ~IncrementalSkimmer() {}
+
+    // Process what changed and merge the fragments into outFileName
+    virtual void analyze(int reportFrequency = 10000);
+
+    int getNProcessed() const { return nProcessed_; }
+    int getNReused()    const { return nReused_;    }
+
+  protected:
+    struct Entry {
+      TString fingerprint;
+      TString configHash;
+      TString fragment;
+    };
+
+    void    readManifest();
+    void    writeManifest() const;
+    TString manifestName() const { return fragmentDir_ + "/manifest.txt"; }
+
+    const TString              fileName_;
+    const TString              treeName_;
+    const TString              outFileName_;
+    const TString              outTreeName_;
+    const TString              fragmentDir_;
+    const TString              configHash_;
+    Factory                    factory_;
+    int                        nThreads_;
+    int                        nProcessed_;
+    int                        nReused_;
+    std::map<TString, Entry>   manifest_;  //by input file
+  };
+
+}
+
+#endif
@@ -26,6 +26,7 @@ NOTES:
 #include <string>
 #include <vector>
 #include "AnalysisTools/DataFormats/interface/Jet.h"
+#include "AnalysisTools/TreeReader/interface/JetReader.h"
 
 
 
@@ -44,7 +45,7 @@ public:
     void setJES(const signed int s) {jet_scale = s;}
     signed int JES() { return jet_scale;}
 
-    void shiftJES(std::vector<RecoJetF>& jets, MomentumF *met);
+    void shiftJES(RecoJetFArenaCollection& jets, MomentumF *met);
 protected:
     enum {
         NOMINAL = 0,
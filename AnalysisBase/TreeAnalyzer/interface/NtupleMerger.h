@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------------------
+//
+// NtupleMerger
+//
+// Merges ntuple files in parallel and adds the cross section weights in the same job.
+// The input files are read into memory by several threads, ahead of the merge and within a memory
+// budget, while the output is appended file by file in input order with an incremental TFileMerger
+// (trees are fast cloned, so every basket is copied once without recompressing it and histograms are
+// summed). The order of the entries is the order of the inputs.
+// The weight branches are then added to the merged tree without rewriting the others, and the summed
+// TreeMetadata of the inputs is stored with the tree so that the events do not have to be counted again.
+//
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISBASE_TREEANALYZER_NTUPLEMERGER_H
+#define ANALYSISBASE_TREEANALYZER_NTUPLEMERGER_H
+
+#include <vector>
+#include <TString.h>
+
+#include "AnalysisTools/Utilities/interface/Types.h"
+#include "AnalysisTools/Utilities/interface/TreeMetadata.h"
+
+namespace ucsbsusy {
+
+  class NtupleMerger {
+  public:
+    // treeName is the path of the tree in the input files, nThreads (reading the inputs) <= 0 uses all available cores
+    NtupleMerger(const std::vector<TString>& inFileNames, TString outFileName, TString treeName = "TestAnalyzer/Events", int nThreads = 0);
+    virtual ~NtupleMerger() {}
+
+    // Add wgtXSec = lumi * crossSection * 1000 / nEvents, xsection and process to the merged tree,
+    // nEvents < 0 uses the source events of the input metadata, or the number of entries of all inputs
+    // The inputs must not have these branches yet, the weight is also stored as wgtXSec in the metadata
+    void setWeights(size8 process, double crossSection, double lumi = 1, Long64_t nEvents = -1);
+    // Total size of the input files that are read ahead into memory, larger files are read by the merge itself
+    void setMaxLoadedBytes(Long64_t maxLoadedBytes) { maxLoadedBytes_ = maxLoadedBytes; }
+
+    // Returns the number of merged entries
+    Long64_t merge();
+
+    Long64_t getTotalEntries() const { return totalEntries_; }
+    const TreeMetadata& getMetadata() const { return metadata_; }
+
+  protected:
+    void     readInputs();
+    void     mergeInputs();
+    void     finalize();
+
+    const std::vector<TString> inFileNames_;
+    const TString              outFileName_;
+    const TString              treeName_;
+    const int                  nThreads_;
+    bool                       addWeights_;
+    size8                      process_;
+    double                     crossSection_;
+    double                     lumi_;
+    Long64_t                   nEvents_;
+    Long64_t                   maxLoadedBytes_;
+    Long64_t                   totalEntries_;
+    TreeMetadata               metadata_;
+  };
+
+}
+
+#endif
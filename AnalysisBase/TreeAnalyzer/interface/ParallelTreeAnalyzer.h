@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------------------------------
+//
+// ParallelTreeAnalyzer
+//
+// Runs a BaseTreeAnalyzer over one tree, or a list of files, with several threads.
+// A single file is split into chunks along the tree clusters, a list of files (anything TreeReader reads
+// as a chain: comma separated, wildcards or .txt/.list files) into one chunk per file. Each chunk is processed by its own
+// analyzer (and so its own TreeReader, TFile and readers) that writes to its own output file.
+// When all chunks are done the chunk outputs are merged in chunk order with TFileMerger:
+// histograms are summed and trees are concatenated, so the event order in the merged output is the
+// same as in a serial job, independent of the thread scheduling.
+//
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISBASE_TREEANALYZER_PARALLELTREEANALYZER_H
+#define ANALYSISBASE_TREEANALYZER_PARALLELTREEANALYZER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <TString.h>
+
+#include "AnalysisBase/TreeAnalyzer/interface/BaseTreeAnalyzer.h"
+
+namespace ucsbsusy {
+
+  class ParallelTreeAnalyzer {
+  public:
+    // Has to return a new analyzer that reads inFileName (one file) and writes all of its output to outFileName
+    // The analyzer is created, run and deleted in the worker thread, so the output should be written
+    // in its destructor (as done by TreeCopier)
+    // Duplicate rejection is not supported: each chunk only knows its own events, so the analyzer must not enable it
+    typedef std::function<BaseTreeAnalyzer*(TString inFileName, TString outFileName)> Factory;
+
+    // nThreads <= 0 uses all available cores, nChunks <= 0 uses four chunks per thread
+    ParallelTreeAnalyzer(TString fileName, TString treeName, TString outFileName, Factory factory, int nThreads = 0, int nChunks = 0);
+    virtual ~ParallelTreeAnalyzer() {}
+
+    // Process the chunks and merge their output into outFileName
+    virtual void analyze(int reportFrequency = 10000, int numEvents = -1);
+
+    void setKeepChunks(bool keep = true) { keepChunks_ = keep; }
+    int  getNThreads() const { return nThreads_; }
+
+  protected:
+    struct Chunk {
+      TString inFileName;
+      int     firstEntry;
+      int     lastEntry;
+      TString outFileName;
+      Chunk(TString inName, int first, int last, TString outName) : inFileName(inName), firstEntry(first), lastEntry(last), outFileName(outName) {}
+    };
+
+    void    makeChunks(int numEvents);
+    void    makeFileChunks(int numEvents);
+    void    runChunk(const Chunk& chunk, int reportFrequency);
+    void    mergeChunks();
+    void    mergeMetadata(const std::vector<TString>& chunkFiles);
+    TString chunkFileName(int iChunk) const;
+
+    const TString      fileName_;
+    const TString      treeName_;
+    const TString      outFileName_;
+    Factory            factory_;
+    int                nThreads_;
+    int                nChunks_;
+    bool               keepChunks_;
+    std::vector<Chunk> chunks_;
+  };
+
+}
+
+#endif
@@ -30,6 +30,13 @@ namespace ucsbsusy {
     virtual void book() {}; //if you want to book your own variables
     virtual void analyze(int reportFrequency = 10000, int numEvents = -1); //actual analyzer
     virtual bool fillEvent() {return true;} //whether or not to fill the event, also fill your custom vars
+    // Fill the output tree from a writer thread, with up to queueDepth entries waiting to be written
+    // Only trees whose branches are all booked through the TreeWriter can be filled this way
+    void setAsyncWriting(int queueDepth = 64) {asyncDepth_ = queueDepth;}
+    // Written with the output tree, the counts are filled by analyze(), the process and cross section can be set before
+    TreeMetadata& getMetadata() {return metadata_;}
+    // Write the (run, lumi, event) of the written events as an EventIndex next to the output tree, needs the event info
+    void setWriteEventIndex(bool write = true) {writeIndex_ = write;}
 
   private:
     void runEvent() {}; //Never used
@@ -38,6 +45,11 @@ namespace ucsbsusy {
 
     TFile*          outFile_;
     TreeWriter*     treeWriter_;
+    int             asyncDepth_;
+    bool            fastClone_;
+    bool            writeIndex_;
+    EventIndex      outputIndex_;
+    TreeMetadata    metadata_;
     TreeWriterData  data;
   };
 
@@ -46,11 +58,21 @@ namespace ucsbsusy {
     TreeCopierAllBranches(TString fileName, TString treeName, TString outFileName, bool isMCTree = false,cfgSet::ConfigSet * pars = 0) :
       TreeCopier(fileName,treeName,outFileName,isMCTree,pars) {}
 
+    // Copy the compressed baskets of the input as they are (TTree fast cloning), only the branches booked
+    // in book() are filled event by event. Every entry is copied, so there can be no entry range,
+    // preselection or rejected event in fillEvent()
+    void setFastCloning(bool fast = true) {fastClone_ = fast;}
+
     virtual void setupTree() {
       reader.getTree()->SetBranchStatus("*",1);
       outFile_ = new TFile(outFileName_,"RECREATE");
       outFile_->cd();
-      treeWriter_ = new TreeWriter(reader.getTree()->CloneTree(0));
+      if(fastClone_){
+        treeWriter_ = new TreeWriter(reader.getTree()->CloneTree(-1,"fast"));
+        reader.restoreBranchStatus(); //only the loaded branches have to be read in the event loop
+      } else {
+        treeWriter_ = new TreeWriter(reader.getTree()->CloneTree(0));
+      }
     }
   };
 
@@ -88,6 +110,9 @@ namespace ucsbsusy {
     virtual void book(TreeWriter * tw) = 0;
     virtual void fill(size i) = 0;
     virtual size  varSize() const = 0;
+    //batched output, all nRows rows of an event are appended at once
+    virtual void bookColumn(ColumnWriter * cw) = 0;
+    virtual void fillColumn(ColumnWriter * cw, size nRows) = 0;
     const std::string name;
     const std::string type;
 
@@ -101,7 +126,10 @@ namespace ucsbsusy {
     void book(TreeWriter * tw) {tw->book(name.c_str(),value, type.c_str());}
     void fill(size i) { value = (*inData);}
     size varSize() const {return 0;}
+    void bookColumn(ColumnWriter * cw) {column = cw->addColumn<Type>(name,type);}
+    void fillColumn(ColumnWriter * cw, size nRows) {cw->fill(column,*inData,nRows);}
   protected:
+    size        column = 0;
     const Type* inData;
     Type        value;
   };
@@ -113,7 +141,10 @@ namespace ucsbsusy {
     void book(TreeWriter * tw) {tw->book(name.c_str(),value, type.c_str());}
     void fill(size i) { value = inData->at(i);}
     size  varSize() const { return inData->size();}
+    void bookColumn(ColumnWriter * cw) {column = cw->addColumn<Type>(name,type);}
+    void fillColumn(ColumnWriter * cw, size nRows) {cw->fill(column,*inData);}
   protected:
+    size        column = 0;
     const std::vector<Type>* inData;
     Type        value;
   };
@@ -156,6 +187,19 @@ namespace ucsbsusy {
       for(auto d : linkedMultiData) d->book(tw);
       isBooked = true;
     }
+    void bookColumns(ColumnWriter * cw){
+      for(auto d : newData) d->bookColumn(cw);
+      for(auto d : linkedData) d->bookColumn(cw);
+      for(auto d : linkedMultiData) d->bookColumn(cw);
+      isBooked = true;
+    }
+    //append all elements of the event, ColumnWriter::endBlock checks that the vectors have the same size
+    void fillColumns(ColumnWriter * cw, size nRows){
+      for(auto d : newData) d->fillColumn(cw,nRows);
+      for(auto d : linkedData) d->fillColumn(cw,nRows);
+      for(auto d : linkedMultiData) d->fillColumn(cw,nRows);
+      cw->endBlock(nRows);
+    }
     void reset(){ for(auto d : newData) d->reset();}
   protected:
     bool isBooked;
@@ -194,6 +238,13 @@ namespace ucsbsusy {
     virtual void book() {}; //if you want to book your own variables
     virtual void analyze(int reportFrequency = 10000, int numEvents = -1); //actual analyzer
     virtual bool fillEvent() {return true;} //whether or not to fill the event, also fill your custom vars
+    // Fill the output tree from a writer thread, with up to queueDepth entries waiting to be written
+    // Only trees whose branches are all booked through the TreeWriter can be filled this way
+    void setAsyncWriting(int queueDepth = 64) {asyncDepth_ = queueDepth;}
+    // Written with the output tree, the counts are filled by analyze(), the process and cross section can be set before
+    TreeMetadata& getMetadata() {return metadata_;}
+    // Write the flattened rows to a ColumnWriter file instead of the output tree, one block per event; outFileName is then not created
+    void setColumnOutput(TString fileName, size chunkRows = 65536) {columnFileName_ = fileName; columnChunkRows_ = chunkRows;}
 
   private:
     void runEvent() {}; //Never used
@@ -202,12 +253,65 @@ namespace ucsbsusy {
 
     TFile*          outFile_;
     TreeWriter*     treeWriter_;
+    int             asyncDepth_;
+    TString         columnFileName_;
+    size            columnChunkRows_;
+    ColumnWriter*   columnWriter_;
+    TreeMetadata    metadata_;
     TreeLinkedWriterData  data;
   };
 
 
 
 
+  //--------------------------------------------------------------------------------------------------
+  // Write several skims in one read of the input: every event is offered to all outputs,
+  // each with its own selection, branches and output file
+  //--------------------------------------------------------------------------------------------------
+  class MultiTreeCopier : public BaseTreeAnalyzer {
+  public:
+    class Output {
+    public:
+      Output(TString name, TString outFileName) : name_(name), outFileName_(outFileName), outFile_(0), treeWriter_(0), nPassed_(0) {}
+      virtual ~Output() {}
+
+      virtual void book(BaseTreeAnalyzer * ana) {}                  //book the variables of this output into data
+      virtual bool fillEvent(BaseTreeAnalyzer * ana) = 0;           //selection, also fill the variables
+
+      const TString& getName() const {return name_;}
+      Long64_t getNPassed()  const {return nPassed_;}
+
+    protected:
+      friend class MultiTreeCopier;
+      const TString   name_;
+      const TString   outFileName_;
+      TFile*          outFile_;
+      TreeWriter*     treeWriter_;
+      TreeWriterData  data;
+      Long64_t        nPassed_;
+    };
+
+    MultiTreeCopier(TString fileName, TString treeName, bool isMCTree = false, cfgSet::ConfigSet * pars = 0);
+    virtual ~MultiTreeCopier(); //writes the outputs and prints the pass counts
+
+    // Takes ownership, has to be called before analyze()
+    void addOutput(Output * output);
+    // Fill the output trees from writer threads, see TreeWriter::setAsync
+    void setAsyncWriting(int queueDepth = 64) {asyncDepth_ = queueDepth;}
+    // Written with the output tree, the counts are filled by analyze(), the process and cross section can be set before
+    TreeMetadata& getMetadata() {return metadata_;}
+
+    virtual void analyze(int reportFrequency = 10000, int numEvents = -1);
+
+  private:
+    void runEvent() {}; //Never used
+  protected:
+    std::vector<Output*> outputs_;
+    int                  asyncDepth_;
+    Long64_t             nProcessed_;
+    TreeMetadata         metadata_;    //shared by all outputs
+  };
+
 }
 
 
@@ -6,7 +6,12 @@
 // 
 //--------------------------------------------------------------------------------------------------
 
+#include <sstream>
+#include <TChain.h>
+#include <TROOT.h>
+
 #include "AnalysisBase/TreeAnalyzer/interface/BaseTreeAnalyzer.h"
+#include "AnalysisTools/Utilities/interface/FileFingerprint.h"
 #include "AnalysisTools/Utilities/interface/PhysicsUtilities.h"
 #include "AnalysisTools/TreeReader/interface/Defaults.h"
 #include "AnalysisBase/TreeAnalyzer/interface/DefaultProcessing.h"
@@ -17,6 +22,9 @@ using namespace ucsbsusy;
 
 //--------------------------------------------------------------------------------------------------
 BaseTreeAnalyzer::BaseTreeAnalyzer(TString fileName, TString treeName, bool isMCTree,cfgSet::ConfigSet * pars, TString readOption) : isLoaded_(false),isProcessed_(false), reader(fileName,treeName,readOption),
+    rejectDuplicates_ (false),
+    nMasked_          (0),
+    nDuplicates_      (0),
     run               (0),
     lumi              (0),
     event             (0),
@@ -82,12 +90,19 @@ BaseTreeAnalyzer::BaseTreeAnalyzer(TString fileName, TString treeName, bool isMC
     jetCorrector.setJES(configSet.jets.JES);
 }
 
+//--------------------------------------------------------------------------------------------------
+BaseTreeAnalyzer::~BaseTreeAnalyzer()
+{
+  if(reader.isProfiling()) printLoadSuggestion();
+  if(lumiMask_)         clog << nMasked_ << " events rejected by the lumi mask" << endl;
+  if(rejectDuplicates_) clog << nDuplicates_ << " duplicate events rejected, " << seenEvents_.getNEvents() << " unique events in " << seenEvents_.getNLumis() << " lumi sections" << endl;
+}
 //--------------------------------------------------------------------------------------------------
 void BaseTreeAnalyzer::load(cfgSet::VarType type, int options, string branchName)
 {
   switch (type) {
     case cfgSet::EVTINFO : {
-      reader.load(&evtInfoReader, 0, "");
+      reader.load(&evtInfoReader, options < 0 ? EventInfoReader::NULLOPT : options, "");
       break;
     }
     case cfgSet::AK4JETS : {
@@ -176,22 +191,67 @@ void BaseTreeAnalyzer::loadVariables()
   if(isMC()) load(cfgSet::GENPARTICLES);
 }
 //--------------------------------------------------------------------------------------------------
+void BaseTreeAnalyzer::printLoadSuggestion(std::ostream& os)
+{
+  struct Entry {
+    TString     type;
+    BaseReader* reader;
+    bool        processed; //used by processVariables with the current configuration
+  };
+  const bool leptons = configSet.selectedLeptons.isConfig() || configSet.vetoedLeptons.isConfig();
+  const Entry entries[] = {
+      {"EVTINFO"     , &evtInfoReader    , true                                                       },
+      {"AK4JETS"     , &ak4Reader        , defaultJets == &ak4Reader       && configSet.jets.isConfig()},
+      {"PUPPIJETS"   , &puppiJetsReader  , defaultJets == &puppiJetsReader && configSet.jets.isConfig()},
+      {"PICKYJETS"   , &pickyJetReader   , defaultJets == &pickyJetReader  && configSet.jets.isConfig()},
+      {"CASUBJETS"   , &caSubJetReader   , defaultJets == &caSubJetReader  && configSet.jets.isConfig()},
+      {"ELECTRONS"   , &electronReader   , leptons                                                    },
+      {"MUONS"       , &muonReader       , leptons                                                    },
+      {"TAUS"        , &tauReader        , false                                                      },
+      {"PHOTONS"     , &photonReader     , configSet.selectedPhotons.isConfig()                       },
+      {"PFCANDS"     , &pfcandReader     , configSet.vetoedTracks.isConfig()                          },
+      {"GENPARTICLES", &genParticleReader, false                                                      },
+      {"CMSTOPS"     , &cmsTopReader     , false                                                      },
+      {"CORRAL"      , &corralReader     , false                                                      }
+  };
+
+  os << "Branch usage by reader:" << endl;
+  os << TString::Format("%-14s %10s %10s %10s %s","reader","accessed","MB","ms","used by") << endl;
+  vector<const Entry*> needed;
+  for(const auto& entry : entries){
+    if(!entry.reader->isLoaded()) continue;
+    const TreeReader::ReaderProfile profile = reader.getReaderProfile(entry.reader);
+    const bool accessed = profile.nAccessed > 0;
+    os << TString::Format("%-14s %4i / %-3i %10.2f %10.1f %s",entry.type.Data(),profile.nAccessed,profile.nBranches,profile.bytes/1.e6,profile.readTime*1.e3,
+                          entry.processed ? (accessed ? "processVariables, access()" : "processVariables") : (accessed ? "access()" : "-")) << endl;
+    if(entry.processed || accessed) needed.push_back(&entry);
+  }
+
+  os << "Suggested loadVariables():" << endl;
+  for(const auto* entry : needed)
+    os << TString::Format("  load(cfgSet::%s, %i, \"%s\");",entry->type.Data(),entry->reader->getOptions(),entry->reader->branchName().c_str()) << endl;
+  os << "Readers only used through their objects in runEvent()/fillEvent() are not seen by the profiler and have to be added back by hand." << endl;
+}
+//--------------------------------------------------------------------------------------------------
 void BaseTreeAnalyzer::processVariables()
 {
   isProcessed_ = true;
 
 
   if(evtInfoReader.isLoaded()) {
-    run   = evtInfoReader.run;
-    lumi  = evtInfoReader.lumi;
-    event = evtInfoReader.event;
-    nPV   = evtInfoReader.nPV;
-    rho   = evtInfoReader.rho;
-    goodvertex=evtInfoReader.goodvertex;
     met   = &evtInfoReader.met;
     genmet= &evtInfoReader.genmet;
-    weight=  evtInfoReader.weight;
-    process =  evtInfoReader.process;
+    //with HEADERONLY the scalars are only available through header()
+    if(!evtInfoReader.hasOption(EventInfoReader::HEADERONLY)){
+      run   = evtInfoReader.run;
+      lumi  = evtInfoReader.lumi;
+      event = evtInfoReader.event;
+      nPV   = evtInfoReader.nPV;
+      rho   = evtInfoReader.rho;
+      goodvertex=evtInfoReader.goodvertex;
+      weight=  evtInfoReader.weight;
+      process =  evtInfoReader.process;
+    }
   }
 
 
@@ -257,11 +317,25 @@ void BaseTreeAnalyzer::processVariables()
     }
   }
   
-  jetCorrector.shiftJES(defaultJets->recoJets, met);
   jets.clear(); bJets.clear(); nonBJets.clear();
+  jetIndices.clear(); bJetIndices.clear(); nonBJetIndices.clear();
+  if(defaultJets && defaultJets->isLoaded() && configSet.jets.isConfig()){
+    if(defaultJets->hasOption(JetReader::FILLCOLUMNS) && !defaultJets->hasOption(JetReader::FILLOBJ)){
+      //columnar mode: no RecoJetF objects, so no corrections can be applied
+      if(jetCorrector.JES() != 0)
+        throw std::invalid_argument("BaseTreeAnalyzer::processVariables(): the JES shift needs jet objects (FILLOBJ)!");
+      if(configSet.jets.applyAdHocPUCorr)
+        throw std::invalid_argument("BaseTreeAnalyzer::processVariables(): the ad hoc PU correction needs jet objects (FILLOBJ)!");
+      cfgSet::selectJets(jetIndices, &bJetIndices, &nonBJetIndices, defaultJets->columns,&selectedLeptons,&vetoedLeptons,&selectedPhotons,configSet.jets,&reader.getArena());
+      nJets    = jetIndices.size();
+      nBJets   = bJetIndices.size();
+      return;
+    }
+  }
+  if(defaultJets) jetCorrector.shiftJES(defaultJets->recoJets, met);
   if(defaultJets && defaultJets->isLoaded() && configSet.jets.isConfig()){
     if(configSet.jets.applyAdHocPUCorr) cfgSet::applyAdHocPUCorr(defaultJets->recoJets, *defaultJets->jetarea_, rho);
-    cfgSet::selectJets(jets, &bJets, &nonBJets, defaultJets->recoJets,&selectedLeptons,&vetoedLeptons,&selectedPhotons,configSet.jets);
+    cfgSet::selectJets(jets, &bJets, &nonBJets, defaultJets->recoJets,&selectedLeptons,&vetoedLeptons,&selectedPhotons,configSet.jets,&reader.getArena());
   }
   nJets    = jets.size();
   nBJets   = bJets.size();
@@ -274,10 +348,116 @@ void BaseTreeAnalyzer::analyze(int reportFrequency, int numEvents)
   loadVariables();
   isLoaded_ = true;
 
+  StageTimer * timer = reader.getTimer();
+  const int preselStage  = timer ? timer->addStage("passPreselection") : -1;
+  const int processStage = timer ? timer->addStage("processVariables") : -1;
+  const int runStage     = timer ? timer->addStage("runEvent")         : -1;
+
   while(reader.nextEvent(reportFrequency)){
     isProcessed_ = false;
-    if(numEvents >= 0 && getEventNumber() >= numEvents) return;
-    processVariables();
+    if(numEvents >= 0 && getEventNumber() >= numEvents) break;
+    {
+      StageTimer::Scope stageTime(timer,preselStage);
+      if(!passEventFilter() || !passPreselection()) continue;
+    }
+    reader.loadEvent();
+    {
+      StageTimer::Scope stageTime(timer,processStage);
+      processVariables();
+    }
+    StageTimer::Scope stageTime(timer,runStage);
     runEvent();
   }
+  endTiming();
+}
+//--------------------------------------------------------------------------------------------------
+void BaseTreeAnalyzer::endTiming()
+{
+  StageTimer * timer = reader.getTimer();
+  if(!timer) return;
+  timer->print();
+  if(timingFile_ != "") timer->write(timingFile_);
+}
+//--------------------------------------------------------------------------------------------------
+void BaseTreeAnalyzer::initMetadata(TreeMetadata& metadata)
+{
+  //anything set before, e.g. the cross section by the job, is kept
+  const TreeMetadata& input = reader.getMetadata();
+  if(metadata.process < 0)      metadata.process      = input.process;
+  if(metadata.crossSection < 0) metadata.crossSection = input.crossSection;
+  if(metadata.sourceFiles.empty()) metadata.sourceFiles = reader.getFileNames();
+  if(metadata.configHash == "") metadata.configHash = configHash(configSet);
+  if(reader.isPreselected()) countInput(metadata);
+}
+//--------------------------------------------------------------------------------------------------
+void BaseTreeAnalyzer::countInput(TreeMetadata& metadata)
+{
+  //the reader only delivers the preselected entries, so all input entries are counted on a separate chain
+  TDirectory * dir = gDirectory;
+  gROOT->cd();
+  TChain input(reader.getTree()->GetName());
+  for(const auto& name : reader.getFileNames()) input.Add(name);
+  //only the entry range of this job, e.g. a ParallelTreeAnalyzer chunk
+  const Long64_t firstEntry = reader.getFirstEntry();
+  const Long64_t lastEntry  = reader.getLastEntry() < 0 ? input.GetEntries() : std::min(Long64_t(reader.getLastEntry()),input.GetEntries());
+  const std::string weightBranch = evtInfoReader.isLoaded() ? reader.getBranchName(&evtInfoReader.weight) : "";
+  if(weightBranch == ""){
+    metadata.sourceEvents += lastEntry - firstEntry;
+    metadata.sumWeights   += lastEntry - firstEntry;
+    metadata.sumWeights2  += lastEntry - firstEntry;
+  } else {
+    float weight = 1;
+    input.SetBranchStatus("*",0);
+    input.SetBranchStatus(weightBranch.c_str(),1);
+    input.SetBranchAddress(weightBranch.c_str(),&weight);
+    for(Long64_t iE = firstEntry; iE < lastEntry; ++iE){
+      input.GetEntry(iE);
+      metadata.addEvent(weight);
+    }
+  }
+  dir->cd();
+}
+//--------------------------------------------------------------------------------------------------
+TString BaseTreeAnalyzer::configHash(const cfgSet::ConfigSet& config)
+{
+  ostringstream stream;
+  stream << config.jets << config.selectedLeptons << config.vetoedLeptons << config.vetoedTracks << config.selectedPhotons;
+  return FileFingerprint::hash(stream.str());
+}
+//--------------------------------------------------------------------------------------------------
+void BaseTreeAnalyzer::countEvent(TreeMetadata& metadata)
+{
+  if(!evtInfoReader.isLoaded()){
+    if(!reader.isPreselected()) metadata.addEvent(1);
+    return;
+  }
+  if(!reader.isPreselected()) metadata.addEvent(access(&evtInfoReader.weight));
+  if(metadata.process < 0) metadata.process = access(&evtInfoReader.proc);
+}
+//--------------------------------------------------------------------------------------------------
+void BaseTreeAnalyzer::setLumiMask(TString jsonFile)
+{
+  if(jsonFile == ""){
+    lumiMask_.reset();
+    return;
+  }
+  lumiMask_.reset(new LumiMask(jsonFile));
+  clog << "Lumi mask " << jsonFile << " with " << lumiMask_->getNLumis() << " lumi sections in " << lumiMask_->getNRuns() << " runs" << endl;
+}
+//--------------------------------------------------------------------------------------------------
+bool BaseTreeAnalyzer::passEventFilter()
+{
+  if(!lumiMask_ && !rejectDuplicates_) return true;
+  if(!evtInfoReader.isLoaded()) throw std::invalid_argument("BaseTreeAnalyzer: the lumi mask and duplicate rejection need load(EVTINFO)");
+  const unsigned int runNumber  = access(&evtInfoReader.run);
+  const unsigned int lumiNumber = access(&evtInfoReader.lumi);
+  if(lumiMask_ && !lumiMask_->contains(runNumber,lumiNumber)){
+    nMasked_++;
+    return false;
+  }
+  if(rejectDuplicates_ && !seenEvents_.insert(runNumber,lumiNumber,access(&evtInfoReader.event))){
+    nDuplicates_++;
+    return false;
+  }
+  return true;
 }
@@ -35,7 +35,7 @@ bool cfgSet::isSelPhoton(const ucsbsusy::PhotonF& pho, const PhotonConfig& conf
   return (pho.pt() > conf.minPt && fabs(pho.eta()) < conf.maxEta && (pho.*conf.selected)());
 }
 
-void cfgSet::selectLeptons(std::vector<ucsbsusy::LeptonF*>& selectedLeptons, std::vector<ucsbsusy::LeptonF*> allLeptons, const LeptonConfig& conf){
+void cfgSet::selectLeptons(std::vector<ucsbsusy::LeptonF*>& selectedLeptons, const std::vector<ucsbsusy::LeptonF*>& allLeptons, const LeptonConfig& conf){
   if(!conf.isConfig())
     throw std::invalid_argument("config::selectLeptons(): You want to do selecting but have not yet configured the selection!");
 
@@ -48,7 +48,7 @@ void cfgSet::selectLeptons(std::vector<ucsbsusy::LeptonF*>& selectedLeptons, std
 
 }
 
-void cfgSet::selectTracks(std::vector<ucsbsusy::PFCandidateF*>& selectedTracks, ucsbsusy::PFCandidateFCollection& allTracks, const TrackConfig& conf){
+void cfgSet::selectTracks(std::vector<ucsbsusy::PFCandidateF*>& selectedTracks, ucsbsusy::PFCandidateFArenaCollection& allTracks, const TrackConfig& conf){
   if(!conf.isConfig())
     throw std::invalid_argument("config::selectTracks(): You want to do selecting but have not yet configured the selection!");
 
@@ -73,7 +73,7 @@ void cfgSet::selectPhotons(std::vector<ucsbsusy::PhotonF*>& selectedPhotons, ucs
 }
 
 void cfgSet::selectJets(std::vector<ucsbsusy::RecoJetF*>& jets, std::vector<ucsbsusy::RecoJetF*>* bJets, std::vector<ucsbsusy::RecoJetF*>* nonBJets,
-    ucsbsusy::RecoJetFCollection& allJets, const std::vector<ucsbsusy::LeptonF*>* selectedLeptons, const std::vector<ucsbsusy::LeptonF*>* vetoedLeptons, const std::vector<ucsbsusy::PhotonF*>* selectedPhotons, const JetConfig&  conf){
+    ucsbsusy::RecoJetFArenaCollection& allJets, const std::vector<ucsbsusy::LeptonF*>* selectedLeptons, const std::vector<ucsbsusy::LeptonF*>* vetoedLeptons, const std::vector<ucsbsusy::PhotonF*>* selectedPhotons, const JetConfig&  conf, ucsbsusy::EventArena * arena){
   if(!conf.isConfig())
     throw std::invalid_argument("config::selectJets(): You want to do selecting but have not yet configured the selection!");
 
@@ -81,7 +81,7 @@ void cfgSet::selectJets(std::vector<ucsbsusy::RecoJetF*>& jets, std::vector<ucsb
   if(bJets){bJets->clear();}
   if(nonBJets){nonBJets->clear(); nonBJets->reserve( std::max(2,int(jets.size())) -2);}
 
-  vector<bool> vetoJet(allJets.size(),false);
+  ArenaVector<bool> vetoJet(allJets.size(),false,ArenaAllocator<bool>(arena));
 
   if(conf.cleanJetsvSelectedLeptons) {
     if(selectedLeptons == 0)
@@ -143,6 +143,96 @@ void cfgSet::selectJets(std::vector<ucsbsusy::RecoJetF*>& jets, std::vector<ucsb
   }
 }
 
+bool cfgSet::isSelBJet(const ucsbsusy::JetColumns& columns, const unsigned int iJ, const JetConfig& conf, const float minCSV){
+  if(columns.csv[iJ] <= (minCSV < -9999 ? conf.defaultCSV : minCSV  ) ) return false;
+  return (columns.pt[iJ] > conf.minBJetPt && fabs(columns.eta[iJ]) < conf.maxBJetEta);
+}
+
+namespace {
+  //Same as PhysicsUtilities::findNearestDR but on the jet columns
+  template<typename Thing>
+  int findNearestJet(const Thing& reference, const ucsbsusy::JetColumns& columns, double maxDeltaR, double minPT){
+    int    bestIndex    = -1;
+    double bestDistance = maxDeltaR*maxDeltaR;
+    for(unsigned int iO = 0; iO < columns.size; ++iO){
+      const unsigned int iJ = columns.ptOrder[iO];
+      if(columns.pt[iJ] < minPT) continue;
+      const double distance = PhysicsUtilities::deltaR2(reference.eta(),reference.phi(),columns.eta[iJ],columns.phi[iJ]);
+      if(distance < bestDistance){
+        bestIndex    = iJ;
+        bestDistance = distance;
+      }
+    }
+    return bestIndex;
+  }
+  template<typename Thing>
+  void vetoNearestJets(const std::vector<Thing*>& references, const ucsbsusy::JetColumns& columns, const cfgSet::JetConfig& conf, ucsbsusy::ArenaVector<bool>& vetoJet){
+    for(const auto* ref : references){
+      int near = findNearestJet(*ref,columns,conf.cleanJetsMaxDR,conf.minPt);
+      if(near >= 0) vetoJet[near] = true;
+    }
+  }
+}
+
+void cfgSet::selectJets(std::vector<ucsbsusy::size16>& jets, std::vector<ucsbsusy::size16>* bJets, std::vector<ucsbsusy::size16>* nonBJets,
+    const ucsbsusy::JetColumns& allJets, const std::vector<ucsbsusy::LeptonF*>* selectedLeptons, const std::vector<ucsbsusy::LeptonF*>* vetoedLeptons, const std::vector<ucsbsusy::PhotonF*>* selectedPhotons, const JetConfig&  conf, ucsbsusy::EventArena * arena){
+  if(!conf.isConfig())
+    throw std::invalid_argument("config::selectJets(): You want to do selecting but have not yet configured the selection!");
+
+  jets.clear(); jets.reserve(allJets.size);
+  if(bJets){bJets->clear();}
+  if(nonBJets){nonBJets->clear();}
+
+  ArenaVector<bool> vetoJet(allJets.size,false,ArenaAllocator<bool>(arena));
+
+  if(conf.cleanJetsvSelectedLeptons) {
+    if(selectedLeptons == 0)
+      throw std::invalid_argument("config::selectJets(): You want to do lepton cleaning but have not given a lepton list to clean!");
+    vetoNearestJets(*selectedLeptons,allJets,conf,vetoJet);
+  }
+
+  if(conf.cleanJetsvVetoedLeptons) {
+    if(vetoedLeptons == 0)
+      throw std::invalid_argument("config::selectJets(): You want to do lepton cleaning but have not given a lepton list to clean!");
+    vetoNearestJets(*vetoedLeptons,allJets,conf,vetoJet);
+  }
+
+  if(conf.cleanJetsvSelectedPhotons) {
+    if(selectedPhotons == 0)
+      throw std::invalid_argument("config::selectJets(): You want to do cleaning but have not given a list to clean with!");
+    vetoNearestJets(*selectedPhotons,allJets,conf,vetoJet);
+  }
+
+  for(const auto iJ : allJets.ptOrder){
+    if(vetoJet[iJ]) continue;
+    if(allJets.pt[iJ] <= conf.minPt ) continue;
+    if(fabs(allJets.eta[iJ]) >= conf.maxEta ) continue;
+    if(conf.applyJetID && !(*allJets.looseId)[iJ]) continue;
+
+    jets.push_back(iJ);
+
+    if(bJets || nonBJets){
+      if(isSelBJet(allJets,iJ,conf)){
+        if(bJets)bJets->push_back(iJ);
+      }
+      else{
+        if(nonBJets)nonBJets->push_back(iJ);
+      }
+    }
+  }
+}
+
+double cfgSet::ht(const ucsbsusy::JetColumns& columns, const std::vector<ucsbsusy::size16>& jets){
+  double ht = 0;
+  for(const auto iJ : jets) ht += columns.pt[iJ];
+  return ht;
+}
+
+int cfgSet::nBJets(const ucsbsusy::JetColumns& columns, const std::vector<ucsbsusy::size16>& jets, const JetConfig& conf, const float minCSV){
+  int nB = 0;
+  for(const auto iJ : jets) if(isSelBJet(columns,iJ,conf,minCSV)) ++nB;
+  return nB;
+}
 
 double cfgSet::adHocPUCorr(double pt,double eta,double area, double rho){
   double constant = 1.08;
@@ -157,7 +247,7 @@ double cfgSet::adHocPUCorr(double pt,double eta,double area, double rho){
   }
   return max(0.,constant*(pt - rho*area*correction) );
 }
-void  cfgSet::applyAdHocPUCorr(ucsbsusy::RecoJetFCollection& jets, const std::vector<float>& jetAreas, const float rho){
+void  cfgSet::applyAdHocPUCorr(ucsbsusy::RecoJetFArenaCollection& jets, const std::vector<float>& jetAreas, const float rho){
   for(auto& j : jets)
     j.setP4(CylLorentzVectorF(adHocPUCorr(j.pt(),j.eta(),jetAreas[j.index()],rho),
         j.eta(),j.phi(),j.mass()) );
@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------------------
+//
+// IncrementalSkimmer
+//
+// Skims a list of input files, only processing the ones that changed since the last run.
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <TROOT.h>
+#include <TSystem.h>
+
+#include "AnalysisBase/TreeAnalyzer/interface/IncrementalSkimmer.h"
+#include "AnalysisBase/TreeAnalyzer/interface/NtupleMerger.h"
+#include "AnalysisTools/Utilities/interface/FileFingerprint.h"
+#include "AnalysisTools/Utilities/interface/RunParallel.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+//--------------------------------------------------------------------------------------------------
+IncrementalSkimmer::IncrementalSkimmer(TString fileName, TString treeName, TString outFileName, TString outTreeName, TString fragmentDir,
+                                       TString configKey, Factory factory, int nThreads) :
+    fileName_   (fileName),
+    treeName_   (treeName),
+    outFileName_(outFileName),
+    outTreeName_(outTreeName),
+    fragmentDir_(fragmentDir),
+    configHash_ (FileFingerprint::hash(configKey)),
+    factory_    (factory),
+    nThreads_   (nThreads > 0 ? nThreads : std::max(1,int(std::thread::hardware_concurrency()))),
+    nProcessed_ (0),
+    nReused_    (0)
+{
+  if(!factory_) throw std::invalid_argument("IncrementalSkimmer: no analyzer factory given!");
+  ROOT::EnableThreadSafety();
+}
+
+//--------------------------------------------------------------------------------------------------
+void IncrementalSkimmer::readManifest()
+{
+  manifest_.clear();
+  ifstream file(manifestName().Data());
+  string input, fingerprint, configHash, fragment;
+  while(file >> fragment >> fingerprint >> configHash >> input){
+    Entry& entry      = manifest_[input.c_str()];
+    entry.fingerprint = fingerprint.c_str();
+    entry.configHash  = configHash.c_str();
+    entry.fragment    = fragment.c_str();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+void IncrementalSkimmer::writeManifest() const
+{
+  //replaced in one step, so an interrupted job leaves the previous manifest
+  const TString tmpName = manifestName() + ".tmp";
+  ofstream file(tmpName.Data());
+  for(const auto& entry : manifest_)
+    file << entry.second.fragment << " " << entry.second.fingerprint << " " << entry.second.configHash << " " << entry.first << "\n";
+  file.close();
+  if(!file || gSystem->Rename(tmpName,manifestName()))
+    throw std::runtime_error((TString("IncrementalSkimmer: could not write ") + manifestName()).Data());
+}
+
+//--------------------------------------------------------------------------------------------------
+void IncrementalSkimmer::analyze(int reportFrequency)
+{
+  gSystem->mkdir(fragmentDir_,true);
+  readManifest();
+
+  const vector<TString> files = TreeReader::getFileList(fileName_,treeName_);
+  if(files.empty()) throw std::invalid_argument((TString("IncrementalSkimmer: no files found for ") + fileName_).Data());
+
+  //fragments of inputs that are gone
+  map<TString, Entry> current;
+  for(const auto& file : files) if(manifest_.count(file)) current[file] = manifest_[file];
+  for(const auto& entry : manifest_)
+    if(!current.count(entry.first)) gSystem->Unlink(entry.second.fragment);
+  manifest_.swap(current);
+
+  //only the file headers are read for the fingerprints
+  vector<TString> fingerprints(files.size());
+  vector<TString> fragments(files.size());
+  vector<unsigned int> todo;
+  for(unsigned int iF = 0; iF < files.size(); ++iF){
+    fingerprints[iF] = FileFingerprint::get(files[iF]);
+    fragments[iF]    = TString::Format("%s/%s.root",fragmentDir_.Data(),FileFingerprint::hash(files[iF]).Data());
+    const auto it = manifest_.find(files[iF]);
+    if(it != manifest_.end() && it->second.fingerprint == fingerprints[iF] && it->second.configHash == configHash_
+       && !gSystem->AccessPathName(it->second.fragment)) continue;
+    manifest_.erase(files[iF]);
+    todo.push_back(iF);
+  }
+  nProcessed_ = todo.size();
+  nReused_    = files.size() - todo.size();
+  clog << "IncrementalSkimmer: processing " << nProcessed_ << " new or changed of " << files.size() << " files, reusing " << nReused_ << " fragments" << endl;
+
+  mutex lock;
+  try {
+    runParallel(todo.size(),nThreads_,[&](unsigned int iT){
+      const unsigned int iF = todo[iT];
+      //deleted also if analyze() throws, the incomplete fragment is not recorded and redone in the next run
+      unique_ptr<BaseTreeAnalyzer> analyzer(factory_(files[iF],fragments[iF]));
+      if(!analyzer) throw std::invalid_argument("IncrementalSkimmer: the factory did not return an analyzer!");
+      analyzer->analyze(reportFrequency);
+      analyzer.reset();
+      //only recorded once the fragment is complete
+      lock_guard<mutex> guard(lock);
+      Entry& entry      = manifest_[files[iF]];
+      entry.fingerprint = fingerprints[iF];
+      entry.configHash  = configHash_;
+      entry.fragment    = fragments[iF];
+    });
+  } catch (...) {
+    //the fragments that were completed are kept even if another one failed
+    writeManifest();
+    throw;
+  }
+  writeManifest();
+
+  NtupleMerger merger(fragments,outFileName_,outTreeName_,nThreads_);
+  merger.merge();
+}
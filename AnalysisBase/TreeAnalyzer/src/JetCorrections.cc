@@ -54,12 +54,11 @@ JetCorrector::~JetCorrector()
  * Function :   JetCorrector::shiftJES()
  * Purpose  :   Shifts jet energy scale - Scales jet pt values by an amount
  *              specified by scaleFactor
- * Input    :   std::vector<recoJetF *> jets - Vector of pointers to jets
- *                                              to be scaled.
+ * Input    :   RecoJetFArenaCollection jets - Reader jets to be scaled
  *              MomentumF *met               - Pointer to MET vector
  * Returns  :   void
  *************************************************************************/
-void JetCorrector::shiftJES(std::vector<RecoJetF>& jets, MomentumF *const met)
+void JetCorrector::shiftJES(RecoJetFArenaCollection& jets, MomentumF *const met)
 {
     float JEC_scale_factor;
 #if DEBUG
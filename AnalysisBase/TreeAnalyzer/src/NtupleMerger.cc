@@ -0,0 +1,262 @@
+//--------------------------------------------------------------------------------------------------
+//
+// NtupleMerger
+//
+// Merges ntuple files in parallel and adds the cross section weights in the same job.
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <TROOT.h>
+#include <TFile.h>
+#include <TMemFile.h>
+#include <TTree.h>
+#include <TFileMerger.h>
+
+#include "AnalysisBase/TreeAnalyzer/interface/NtupleMerger.h"
+#include "AnalysisTools/Utilities/interface/TreeWriter.h"
+#include "AnalysisTools/Utilities/interface/RunParallel.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+namespace {
+  // The merged tree is not split into several files, restores the process-wide limit afterwards
+  struct MaxTreeSizeScope {
+    const Long64_t oldSize;
+    MaxTreeSizeScope(Long64_t size) : oldSize(TTree::GetMaxTreeSize()) { TTree::SetMaxTreeSize(size); }
+    ~MaxTreeSizeScope() { TTree::SetMaxTreeSize(oldSize); }
+  };
+}
+
+//--------------------------------------------------------------------------------------------------
+NtupleMerger::NtupleMerger(const vector<TString>& inFileNames, TString outFileName, TString treeName, int nThreads) :
+    inFileNames_ (inFileNames),
+    outFileName_ (outFileName),
+    treeName_    (treeName),
+    nThreads_    (nThreads > 0 ? nThreads : std::max(1,int(std::thread::hardware_concurrency()))),
+    addWeights_  (false),
+    process_     (0),
+    crossSection_(0),
+    lumi_        (0),
+    nEvents_     (-1),
+    maxLoadedBytes_(Long64_t(2) << 30),
+    totalEntries_(0)
+{
+  if(inFileNames_.empty()) throw std::invalid_argument("NtupleMerger: no input files given!");
+  ROOT::EnableThreadSafety();
+}
+
+//--------------------------------------------------------------------------------------------------
+void NtupleMerger::setWeights(size8 process, double crossSection, double lumi, Long64_t nEvents)
+{
+  addWeights_   = true;
+  process_      = process;
+  crossSection_ = crossSection;
+  lumi_         = lumi;
+  nEvents_      = nEvents;
+}
+
+//--------------------------------------------------------------------------------------------------
+void NtupleMerger::readInputs()
+{
+  //only the tree headers are read
+  vector<Long64_t>     entries(inFileNames_.size(),0);
+  vector<TreeMetadata> metadata(inFileNames_.size());
+  vector<char>         hasMetadata(inFileNames_.size(),0);
+  runParallel(inFileNames_.size(),nThreads_,[&](unsigned int iF){
+    TFile * file = TFile::Open(inFileNames_[iF],"READ");
+    if(!file || file->IsZombie()) throw std::invalid_argument((TString("NtupleMerger: could not open file: ") + inFileNames_[iF]).Data());
+    TTree * tree = (TTree*)(file->Get(treeName_));
+    if(!tree) throw std::invalid_argument((TString("NtupleMerger: could not find ") + treeName_ + " in " + inFileNames_[iF]).Data());
+    entries[iF]     = tree->GetEntries();
+    hasMetadata[iF] = metadata[iF].read(tree);
+    if(addWeights_)
+      for(const char * name : {"wgtXSec","xsection","process"})
+        if(tree->GetBranch(name)) throw std::invalid_argument((TString("NtupleMerger: ") + inFileNames_[iF] + " already has a " + name + " branch").Data());
+    delete file;
+  });
+
+  //inputs without metadata are raw ntuples: every entry is a source event with weight 1
+  totalEntries_ = 0;
+  metadata_     = TreeMetadata();
+  for(unsigned int iF = 0; iF < inFileNames_.size(); ++iF){
+    totalEntries_ += entries[iF];
+    if(!hasMetadata[iF]){
+      metadata[iF].sourceEvents = entries[iF];
+      metadata[iF].sumWeights   = entries[iF];
+      metadata[iF].sumWeights2  = entries[iF];
+      metadata[iF].sourceFiles.push_back(inFileNames_[iF]);
+    }
+    metadata_.add(metadata[iF]);
+  }
+  metadata_.entries = totalEntries_;
+}
+
+//--------------------------------------------------------------------------------------------------
+void NtupleMerger::mergeInputs()
+{
+  const unsigned int nFiles = inFileNames_.size();
+  vector<TFile*>   loaded(nFiles,0);
+  vector<Long64_t> loadedSizes(nFiles,0);
+  vector<char>     ready(nFiles,0);
+  unsigned int     nextMerge   = 0;
+  Long64_t         loadedBytes = 0;
+  bool             stop        = false;
+  bool             loadersDone = false;
+  exception_ptr      loadError;
+  mutex              lock;
+  condition_variable changed;
+
+  //the inputs are read into memory in input order, the file the merge waits for is always read
+  auto loadFile = [&](unsigned int iF){
+    unique_ptr<TFile> file(TFile::Open(inFileNames_[iF],"READ"));
+    if(!file || file->IsZombie()) throw std::invalid_argument((TString("NtupleMerger: could not open file: ") + inFileNames_[iF]).Data());
+    const Long64_t size = file->GetSize();
+    TFile * memFile = 0;
+    if(size <= maxLoadedBytes_){
+      {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard,[&]{ return stop || iF == nextMerge || loadedBytes + size <= maxLoadedBytes_; });
+        if(stop) return;
+        loadedBytes     += size;
+        loadedSizes[iF]  = size;
+      }
+      //raw copy of the file, in blocks since a single read is limited to 2 GB
+      const Long64_t blockSize = Long64_t(1) << 26;
+      unique_ptr<char[]> buffer(new char[size]);
+      for(Long64_t pos = 0; pos < size; pos += blockSize)
+        if(file->ReadBuffer(buffer.get() + pos,pos,Int_t(std::min(blockSize,size - pos))))
+          throw std::runtime_error((TString("NtupleMerger: could not read ") + inFileNames_[iF]).Data());
+      file.reset();
+      memFile = new TMemFile(inFileNames_[iF],buffer.get(),size);
+    }
+    lock_guard<mutex> guard(lock);
+    loaded[iF] = memFile;
+    ready[iF]  = 1;
+    changed.notify_all();
+  };
+  //a failed read stops the other readers, which could otherwise wait for memory that is never freed
+  auto load = [&](unsigned int iF){
+    try {
+      loadFile(iF);
+    } catch (...) {
+      lock_guard<mutex> guard(lock);
+      stop = true;
+      changed.notify_all();
+      throw;
+    }
+  };
+  thread loader([&]{
+    try {
+      runParallel(nFiles,nThreads_,load);
+    } catch (...) {
+      loadError = current_exception();
+    }
+    lock_guard<mutex> guard(lock);
+    loadersDone = true;
+    changed.notify_all();
+  });
+
+  //a TFile is written by one thread, the output is appended while the next inputs are being read
+  try {
+    TFileMerger merger(kFALSE);
+    merger.SetFastMethod(kTRUE);
+    merger.SetPrintLevel(0);
+    if(!merger.OutputFile(outFileName_,"RECREATE"))
+      throw std::invalid_argument((TString("NtupleMerger: could not create output file: ") + outFileName_).Data());
+    for(unsigned int iF = 0; iF < nFiles; ++iF){
+      TFile * memFile = 0;
+      {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard,[&]{ return ready[iF] || loadersDone; });
+        if(!ready[iF]) break;
+        memFile     = loaded[iF];
+        loaded[iF]  = 0;
+      }
+      //the merger deletes the adopted file once it is merged
+      if(memFile) merger.AddAdoptFile(memFile);
+      else if(!merger.AddFile(inFileNames_[iF],kFALSE))
+        throw std::invalid_argument((TString("NtupleMerger: could not add file: ") + inFileNames_[iF]).Data());
+      if(!merger.PartialMerge(TFileMerger::kIncremental | TFileMerger::kAll))
+        throw std::runtime_error((TString("NtupleMerger: merging ") + inFileNames_[iF] + " into " + outFileName_ + " failed").Data());
+      lock_guard<mutex> guard(lock);
+      loadedBytes -= loadedSizes[iF];
+      nextMerge    = iF + 1;
+      changed.notify_all();
+    }
+    merger.GetOutputFile()->Close();
+  } catch (...) {
+    {
+      lock_guard<mutex> guard(lock);
+      stop = true;
+      changed.notify_all();
+    }
+    loader.join();
+    for(auto * memFile : loaded) delete memFile;
+    throw;
+  }
+  loader.join();
+  for(auto * memFile : loaded) delete memFile;
+  if(loadError) rethrow_exception(loadError);
+}
+
+//--------------------------------------------------------------------------------------------------
+void NtupleMerger::finalize()
+{
+  TFile * file = TFile::Open(outFileName_,"UPDATE");
+  if(!file || file->IsZombie()) throw std::invalid_argument((TString("NtupleMerger: could not open ") + outFileName_).Data());
+  TTree * tree = (TTree*)(file->Get(treeName_));
+  if(!tree) throw std::invalid_argument((TString("NtupleMerger: could not find ") + treeName_ + " in " + outFileName_).Data());
+
+  TreeWriter * writer = new TreeWriter(tree,tree->GetName());
+  if(addWeights_){
+    const Long64_t nEvents = nEvents_ >= 0 ? nEvents_ : metadata_.sourceEvents;
+    float wgtXSec  = lumi_ * crossSection_ * 1000 / (nEvents > 0 ? nEvents : 1);
+    float xsection = crossSection_;
+    size8 process  = process_;
+
+    //only the new branches are filled, the merged baskets are not touched
+    const int nOld = tree->GetListOfBranches()->GetEntries();
+    writer->book("wgtXSec" ,wgtXSec ,"F");
+    writer->book("xsection",xsection,"F");
+    writer->book("process" ,process ,"b");
+    vector<TBranch*> newBranches;
+    for(int iB = nOld; iB < tree->GetListOfBranches()->GetEntries(); ++iB)
+      newBranches.push_back((TBranch*)tree->GetListOfBranches()->At(iB));
+    for(Long64_t iE = 0; iE < tree->GetEntries(); ++iE)
+      for(auto* branch : newBranches) branch->Fill();
+
+    //the counts keep describing the inputs, the normalization is stored on its own
+    metadata_.wgtXSec      = wgtXSec;
+    metadata_.process      = process_;
+    metadata_.crossSection = crossSection_;
+    clog << "Added wgtXSec = " << wgtXSec << ", xsection = " << xsection << " and process = " << int(process) << " for " << nEvents << " events" << endl;
+  }
+  writer->writeMetadata(metadata_);
+
+  tree->GetDirectory()->cd();
+  tree->Write(0,TObject::kOverwrite);
+  delete writer;
+  file->Close();
+  delete file;
+}
+
+//--------------------------------------------------------------------------------------------------
+Long64_t NtupleMerger::merge()
+{
+  readInputs();
+  clog << "Merging " << inFileNames_.size() << " files with " << totalEntries_ << " entries into " << outFileName_ << ", reading on " << nThreads_ << " threads" << endl;
+
+  MaxTreeSizeScope maxTreeSize(kMaxLong64);
+  mergeInputs();
+  finalize();
+  clog << outFileName_ << " created!" << endl;
+  return totalEntries_;
+}
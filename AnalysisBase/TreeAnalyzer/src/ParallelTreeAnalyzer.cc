@@ -0,0 +1,194 @@
+//--------------------------------------------------------------------------------------------------
+//
+// ParallelTreeAnalyzer
+//
+// Runs a BaseTreeAnalyzer over one tree with several threads.
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <TROOT.h>
+#include <TChain.h>
+#include <TFile.h>
+#include <TFileMerger.h>
+#include <TKey.h>
+#include <TClass.h>
+#include <TSystem.h>
+
+#include "AnalysisBase/TreeAnalyzer/interface/ParallelTreeAnalyzer.h"
+#include "AnalysisTools/Utilities/interface/TreeMetadata.h"
+#include "AnalysisTools/Utilities/interface/RunParallel.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+//--------------------------------------------------------------------------------------------------
+ParallelTreeAnalyzer::ParallelTreeAnalyzer(TString fileName, TString treeName, TString outFileName, Factory factory, int nThreads, int nChunks) :
+    fileName_   (fileName),
+    treeName_   (treeName),
+    outFileName_(outFileName),
+    factory_    (factory),
+    nThreads_   (nThreads > 0 ? nThreads : std::max(1,int(std::thread::hardware_concurrency()))),
+    nChunks_    (nChunks  > 0 ? nChunks  : 4*nThreads_),
+    keepChunks_ (false)
+{
+  if(!factory_) throw std::invalid_argument("ParallelTreeAnalyzer: no analyzer factory given!");
+  //per-thread gDirectory and locking of the ROOT internals, needed before any worker opens a file
+  ROOT::EnableThreadSafety();
+}
+
+//--------------------------------------------------------------------------------------------------
+TString ParallelTreeAnalyzer::chunkFileName(int iChunk) const
+{
+  TString name = outFileName_;
+  if(name.EndsWith(".root")) name.Resize(name.Length() - 5);
+  return TString::Format("%s_chunk%i.root",name.Data(),iChunk);
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelTreeAnalyzer::makeChunks(int numEvents)
+{
+  chunks_.clear();
+  if(TreeReader::isFileList(fileName_)){
+    makeFileChunks(numEvents);
+    return;
+  }
+
+  TFile * file = TFile::Open(fileName_,"READ");
+  if(!file) throw std::invalid_argument((TString("ParallelTreeAnalyzer: could not open file: ") + fileName_).Data());
+  TTree * tree = (TTree*)(file->Get(treeName_));
+  if(!tree) throw std::invalid_argument((TString("ParallelTreeAnalyzer: could not find tree: ") + treeName_).Data());
+
+  Long64_t nEntries = tree->GetEntries();
+  if(numEvents >= 0 && numEvents < nEntries) nEntries = numEvents;
+
+  //only cut on cluster boundaries so that no basket has to be read by two threads
+  vector<Long64_t> boundaries;
+  TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+  Long64_t clusterStart;
+  while((clusterStart = clusters()) < nEntries) boundaries.push_back(clusterStart);
+  boundaries.push_back(nEntries);
+
+  file->Close();
+  delete file;
+
+  const Long64_t target = std::max(Long64_t(1), (nEntries + nChunks_ - 1) / nChunks_);
+  Long64_t first = 0;
+  for(unsigned int iB = 1; iB < boundaries.size(); ++iB){
+    if(boundaries[iB] - first < target && iB + 1 < boundaries.size()) continue;
+    chunks_.emplace_back(fileName_,first,boundaries[iB],chunkFileName(chunks_.size()));
+    first = boundaries[iB];
+  }
+
+  clog << "Splitting " << nEntries << " entries into " << chunks_.size() << " chunks on " << nThreads_ << " threads" << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelTreeAnalyzer::makeFileChunks(int numEvents)
+{
+  const vector<TString> files = TreeReader::getFileList(fileName_,treeName_);
+  if(files.empty()) throw std::invalid_argument((TString("ParallelTreeAnalyzer: no files found for ") + fileName_).Data());
+
+  //one chunk per file, the entry offsets are only needed to stop after numEvents
+  TChain chain(treeName_);
+  for(const auto& file : files) chain.Add(file);
+  Long64_t nEntries = chain.GetEntries();
+  if(numEvents >= 0 && numEvents < nEntries) nEntries = numEvents;
+
+  for(unsigned int iF = 0; iF < files.size(); ++iF){
+    const Long64_t offset = chain.GetTreeOffset()[iF];
+    if(offset >= nEntries) break;
+    const Long64_t fileEntries = chain.GetTreeOffset()[iF + 1] - offset;
+    chunks_.emplace_back(files[iF],0,offset + fileEntries > nEntries ? nEntries - offset : -1,chunkFileName(chunks_.size()));
+  }
+
+  clog << "Splitting " << nEntries << " entries in " << files.size() << " files into " << chunks_.size() << " chunks on " << nThreads_ << " threads" << endl;
+}
+//--------------------------------------------------------------------------------------------------
+void ParallelTreeAnalyzer::runChunk(const Chunk& chunk, int reportFrequency)
+{
+  unique_ptr<BaseTreeAnalyzer> analyzer(factory_(chunk.inFileName,chunk.outFileName));
+  if(!analyzer) throw std::invalid_argument("ParallelTreeAnalyzer: the factory did not return an analyzer!");
+  if(analyzer->isRejectingDuplicates())
+    throw std::invalid_argument("ParallelTreeAnalyzer: duplicate rejection only sees the events of one chunk, run serially instead!");
+  analyzer->setEntryRange(chunk.firstEntry,chunk.lastEntry);
+  analyzer->analyze(reportFrequency);
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelTreeAnalyzer::mergeChunks()
+{
+  TFileMerger merger(kFALSE);
+  if(!merger.OutputFile(outFileName_,"RECREATE"))
+    throw std::invalid_argument((TString("ParallelTreeAnalyzer: could not create output file: ") + outFileName_).Data());
+
+  //chunk order is entry order, which keeps the merged trees in the same order as a serial job
+  vector<TString> added;
+  for(const auto& chunk : chunks_){
+    if(gSystem->AccessPathName(chunk.outFileName)){
+      clog << "ParallelTreeAnalyzer: chunk output " << chunk.outFileName << " was not written, skipping it" << endl;
+      continue;
+    }
+    merger.AddFile(chunk.outFileName,kFALSE);
+    added.push_back(chunk.outFileName);
+  }
+  const int nAdded = added.size();
+  if(nAdded && !merger.Merge())
+    throw std::runtime_error((TString("ParallelTreeAnalyzer: merging into ") + outFileName_ + " failed").Data());
+  if(nAdded) mergeMetadata(added);
+
+  if(!keepChunks_)
+    for(const auto& chunk : chunks_) gSystem->Unlink(chunk.outFileName);
+
+  clog << "Merged " << nAdded << " chunks into " << outFileName_ << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelTreeAnalyzer::mergeMetadata(const vector<TString>& chunkFiles)
+{
+  //TFileMerger keeps the UserInfo of the first chunk only, so the metadata of the trees is summed over all chunks
+  TFile * output = TFile::Open(outFileName_,"UPDATE");
+  if(!output || output->IsZombie()) throw std::runtime_error((TString("ParallelTreeAnalyzer: could not open ") + outFileName_).Data());
+
+  vector<TString> treeNames;
+  TIter nextKey(output->GetListOfKeys());
+  while(TKey * key = (TKey*)nextKey())
+    if(TClass::GetClass(key->GetClassName())->InheritsFrom(TTree::Class())) treeNames.push_back(key->GetName());
+
+  for(const auto& treeName : treeNames){
+    TreeMetadata metadata;
+    bool         hasMetadata = false;
+    for(const auto& chunkFile : chunkFiles){
+      TFile * file = TFile::Open(chunkFile,"READ");
+      TTree * tree = file ? (TTree*)(file->Get(treeName)) : 0;
+      TreeMetadata chunkMetadata;
+      if(tree && chunkMetadata.read(tree)){
+        metadata.add(chunkMetadata);
+        hasMetadata = true;
+      }
+      delete file;
+    }
+    if(!hasMetadata) continue;
+
+    TTree * tree = (TTree*)(output->Get(treeName));
+    metadata.entries = tree->GetEntries();
+    metadata.write(tree);
+    output->cd();
+    tree->Write(0,TObject::kOverwrite);
+  }
+
+  output->Close();
+  delete output;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelTreeAnalyzer::analyze(int reportFrequency, int numEvents)
+{
+  makeChunks(numEvents);
+
+  runParallel(chunks_.size(),nThreads_,[&](unsigned int iC){ runChunk(chunks_[iC],reportFrequency); });
+
+  mergeChunks();
+}
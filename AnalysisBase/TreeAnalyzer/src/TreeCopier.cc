@@ -5,27 +5,77 @@ using namespace ucsbsusy;
 
 
 TreeCopier::TreeCopier(TString fileName, TString treeName, TString outFileName, bool isMCTree,cfgSet::ConfigSet * pars)
-: BaseTreeAnalyzer(fileName,treeName,isMCTree,pars,"READ"), outFileName_(outFileName), outFile_(0), treeWriter_(0)
+: BaseTreeAnalyzer(fileName,treeName,isMCTree,pars,"READ"), outFileName_(outFileName), outFile_(0), treeWriter_(0), asyncDepth_(0), fastClone_(false), writeIndex_(false)
 {};
-TreeCopier::~TreeCopier(){ if(!outFile_) return; outFile_->cd(); outFile_->Write(0, TObject::kWriteDelete); outFile_->Close(); }
+TreeCopier::~TreeCopier(){
+  if(!outFile_) return;
+  if(treeWriter_ && isLoaded_) treeWriter_->writeMetadata(metadata_);
+  if(treeWriter_ && writeIndex_) treeWriter_->writeEventIndex(outputIndex_);
+  if(treeWriter_) treeWriter_->finish();
+  outFile_->cd();
+  outFile_->Write(0, TObject::kWriteDelete);
+  if(treeWriter_ && treeWriter_->doReport()) treeWriter_->printReport();
+  outFile_->Close();
+}
 
 //--------------------------------------------------------------------------------------------------
 void TreeCopier::analyze(int reportFrequency, int numEvents)
 {
   loadVariables();
   isLoaded_ = true;
+  initMetadata(metadata_);
+  if(fastClone_ && (reader.getFirstEntry() > 0 || reader.getLastEntry() >= 0 || reader.isPreselected() || (numEvents >= 0 && numEvents < getEntries())))
+    throw std::invalid_argument("TreeCopier::analyze: fast cloning copies all entries, it cannot be used with an entry range or preselection");
   setupTree();
+  if(asyncDepth_ > 0 && !fastClone_) treeWriter_->setAsync(asyncDepth_);
   book();
+  const int nCloned = treeWriter_->getTree()->GetListOfBranches()->GetEntries();
   data.book(treeWriter_);
+
+  //with fast cloning the tree already has all entries, only the new branches are filled
+  vector<TBranch*> newBranches;
+  if(fastClone_)
+    for(int iB = nCloned; iB < treeWriter_->getTree()->GetListOfBranches()->GetEntries(); ++iB)
+      newBranches.push_back((TBranch*)treeWriter_->getTree()->GetListOfBranches()->At(iB));
+
+  StageTimer * timer = reader.getTimer();
+  const int preselStage  = timer ? timer->addStage("passPreselection") : -1;
+  const int processStage = timer ? timer->addStage("processVariables") : -1;
+  const int fillStage    = timer ? timer->addStage("fillEvent")        : -1;
+  const int writeStage   = timer ? timer->addStage("TreeWriter::fill") : -1;
+
   while(reader.nextEvent(reportFrequency)){
     isProcessed_ = false;
-    if(numEvents >= 0 && getEventNumber() >= numEvents) return;
-    processVariables();
-    data.reset();
-    if(!fillEvent()) continue;
+    if(numEvents >= 0 && getEventNumber() >= numEvents) break;
+    countEvent(metadata_);
+    bool accepted;
+    {
+      StageTimer::Scope stageTime(timer,preselStage);
+      accepted = passEventFilter() && passPreselection();
+    }
+    if(accepted){
+      reader.loadEvent();
+      {
+        StageTimer::Scope stageTime(timer,processStage);
+        processVariables();
+      }
+      data.reset();
+      StageTimer::Scope stageTime(timer,fillStage);
+      accepted = fillEvent();
+    }
+    if(fastClone_ && !accepted)
+      throw std::runtime_error("TreeCopier::analyze: fast cloning copies all entries, the event filters, passPreselection() and fillEvent() cannot reject events");
+    if(!accepted) continue;
+    StageTimer::Scope stageTime(timer,writeStage);
     outFile_->cd();
-    treeWriter_->fill();
+    if(fastClone_)
+      for(auto* branch : newBranches) branch->Fill();
+    else
+      treeWriter_->fill();
+    if(writeIndex_) outputIndex_.insert(evtInfoReader.run,evtInfoReader.lumi,evtInfoReader.event);
   }
+  treeWriter_->finish();
+  endTiming();
 }
 
 
@@ -34,36 +84,170 @@ void TreeCopier::analyze(int reportFrequency, int numEvents)
 //--------------------------------------------------------------------------------------------------
 
 TreeFlattenCopier::TreeFlattenCopier(TString fileName, TString treeName, TString outFileName, bool isMCTree,cfgSet::ConfigSet * pars)
-: BaseTreeAnalyzer(fileName,treeName,isMCTree,pars,"READ"), outFileName_(outFileName), outFile_(0), treeWriter_(0)
-{
-  outFile_ = new TFile(outFileName_,"RECREATE");
+: BaseTreeAnalyzer(fileName,treeName,isMCTree,pars,"READ"), outFileName_(outFileName), outFile_(0), treeWriter_(0), asyncDepth_(0), columnChunkRows_(0), columnWriter_(0)
+{};
+TreeFlattenCopier::~TreeFlattenCopier(){
+  delete columnWriter_;
+  if(!treeWriter_) return;
+  if(isLoaded_) treeWriter_->writeMetadata(metadata_);
+  treeWriter_->finish();
   outFile_->cd();
-  treeWriter_ = new TreeWriter(new TTree(reader.getTree()->GetName(),reader.getTree()->GetTitle()),reader.getTree()->GetName() );
-};
-TreeFlattenCopier::~TreeFlattenCopier(){outFile_->cd(); outFile_->Write(0, TObject::kWriteDelete); outFile_->Close(); }
+  outFile_->Write(0, TObject::kWriteDelete);
+  if(treeWriter_->doReport()) treeWriter_->printReport();
+  outFile_->Close();
+}
 
 //--------------------------------------------------------------------------------------------------
 void TreeFlattenCopier::analyze(int reportFrequency, int numEvents)
 {
   loadVariables();
   isLoaded_ = true;
+  initMetadata(metadata_);
+  //the output tree is only made if the rows are not written as columns
+  if(columnFileName_ == ""){
+    outFile_ = new TFile(outFileName_,"RECREATE");
+    outFile_->cd();
+    treeWriter_ = new TreeWriter(new TTree(reader.getTree()->GetName(),reader.getTree()->GetTitle()),reader.getTree()->GetName() );
+    if(asyncDepth_ > 0) treeWriter_->setAsync(asyncDepth_);
+  }
   book();
-  data.book(treeWriter_);
+  if(columnFileName_ != ""){
+    columnWriter_ = new ColumnWriter(columnFileName_,columnChunkRows_);
+    data.bookColumns(columnWriter_);
+  } else {
+    data.book(treeWriter_);
+  }
+
+  StageTimer * timer = reader.getTimer();
+  const int preselStage  = timer ? timer->addStage("passPreselection") : -1;
+  const int processStage = timer ? timer->addStage("processVariables") : -1;
+  const int fillStage    = timer ? timer->addStage("fillEvent")        : -1;
+  const int writeStage   = timer ? timer->addStage("TreeWriter::fill") : -1;
+
   while(reader.nextEvent(reportFrequency)){
     isProcessed_ = false;
-    if(numEvents >= 0 && getEventNumber() >= numEvents) return;
-    processVariables();
+    if(numEvents >= 0 && getEventNumber() >= numEvents) break;
+    countEvent(metadata_);
+    {
+      StageTimer::Scope stageTime(timer,preselStage);
+      if(!passEventFilter() || !passPreselection()) continue;
+    }
+    reader.loadEvent();
+    {
+      StageTimer::Scope stageTime(timer,processStage);
+      processVariables();
+    }
     data.reset();
-    if(!fillEvent()) continue;
-    data.fillLinked();
+    {
+      StageTimer::Scope stageTime(timer,fillStage);
+      if(!fillEvent()) continue;
+    }
+    StageTimer::Scope stageTime(timer,writeStage);
     size num = data.getVecSize();
+    if(columnWriter_){
+      data.fillColumns(columnWriter_,num);
+      continue;
+    }
+    data.fillLinked();
     for(size i = 0; i < num; ++i ){
       data.fillLinkedMulti(i);
       outFile_->cd();
       treeWriter_->fill();
     }
   }
+  if(treeWriter_) treeWriter_->finish();
+  if(columnWriter_){
+    columnWriter_->close();
+    clog << "Wrote " << columnWriter_->getNRows() << " rows in " << columnWriter_->getNColumns() << " columns to " << columnFileName_ << endl;
+  }
+  endTiming();
+}
+
+
+
+
+
+//--------------------------------------------------------------------------------------------------
+// MultiTreeCopier
+//--------------------------------------------------------------------------------------------------
+
+MultiTreeCopier::MultiTreeCopier(TString fileName, TString treeName, bool isMCTree,cfgSet::ConfigSet * pars)
+: BaseTreeAnalyzer(fileName,treeName,isMCTree,pars,"READ"), asyncDepth_(0), nProcessed_(0)
+{};
+
+MultiTreeCopier::~MultiTreeCopier(){
+  for(auto* output : outputs_){
+    if(output->outFile_){
+      output->treeWriter_->writeMetadata(metadata_);
+      output->treeWriter_->finish();
+      output->outFile_->cd();
+      output->outFile_->Write(0, TObject::kWriteDelete);
+      output->outFile_->Close();
+    }
+    clog << TString::Format("%-20s passed %10lld of %10lld events, written to %s",output->name_.Data(),output->nPassed_,nProcessed_,output->outFileName_.Data()) << endl;
+    delete output;
+  }
 }
 
+//--------------------------------------------------------------------------------------------------
+void MultiTreeCopier::addOutput(Output * output)
+{
+  assert(!isLoaded_);
+  for(const auto* other : outputs_)
+    if(other->name_ == output->name_ || other->outFileName_ == output->outFileName_)
+      throw std::invalid_argument((TString("MultiTreeCopier::addOutput: output ") + output->name_ + " has the same name or file as " + other->name_).Data());
+  outputs_.push_back(output);
+}
 
+//--------------------------------------------------------------------------------------------------
+void MultiTreeCopier::analyze(int reportFrequency, int numEvents)
+{
+  if(outputs_.empty()) throw std::invalid_argument("MultiTreeCopier::analyze: no outputs added!");
+  loadVariables();
+  isLoaded_ = true;
+  initMetadata(metadata_);
+  for(auto* output : outputs_){
+    output->outFile_ = new TFile(output->outFileName_,"RECREATE");
+    if(output->outFile_->IsZombie()) throw std::invalid_argument((TString("MultiTreeCopier::analyze: could not create ") + output->outFileName_).Data());
+    output->outFile_->cd();
+    output->treeWriter_ = new TreeWriter(new TTree(reader.getTree()->GetName(),reader.getTree()->GetTitle()),reader.getTree()->GetName() );
+    if(asyncDepth_ > 0) output->treeWriter_->setAsync(asyncDepth_);
+    output->book(this);
+    output->data.book(output->treeWriter_);
+  }
+
+  StageTimer * timer = reader.getTimer();
+  const int preselStage  = timer ? timer->addStage("passPreselection") : -1;
+  const int processStage = timer ? timer->addStage("processVariables") : -1;
+  const int fillStage    = timer ? timer->addStage("fillEvent")        : -1;
+  const int writeStage   = timer ? timer->addStage("TreeWriter::fill") : -1;
 
+  while(reader.nextEvent(reportFrequency)){
+    isProcessed_ = false;
+    if(numEvents >= 0 && getEventNumber() >= numEvents) break;
+    countEvent(metadata_);
+    nProcessed_++;
+    {
+      StageTimer::Scope stageTime(timer,preselStage);
+      if(!passEventFilter() || !passPreselection()) continue;
+    }
+    reader.loadEvent();
+    {
+      StageTimer::Scope stageTime(timer,processStage);
+      processVariables();
+    }
+    for(auto* output : outputs_){
+      output->data.reset();
+      {
+        StageTimer::Scope stageTime(timer,fillStage);
+        if(!output->fillEvent(this)) continue;
+      }
+      StageTimer::Scope stageTime(timer,writeStage);
+      output->outFile_->cd();
+      output->treeWriter_->fill();
+      output->nPassed_++;
+    }
+  }
+  for(auto* output : outputs_) output->treeWriter_->finish();
+  endTiming();
+}
@@ -15,6 +15,7 @@
 #include "TTree.h"
 #include "map"
 #include "vector"
+#include "functional"
 #include "AnalysisMethods/PlotUtils/interface/Plot.hh"
 #include "AnalysisMethods/PlotUtils/interface/Sample.hh"
 #include "AnalysisMethods/PlotUtils/interface/StyleTools.hh"
@@ -141,6 +142,9 @@ class PlotStuff {
         unsigned int           plotoverflow;
         bool                   make_integral;
         bool                   reverse_integral_dir;
+        unsigned int           nthreads;
+        Long64_t               entriesperjob;
+        TString                histcache;
 
         PlotConfig() :
           type(DATAMC),
@@ -180,7 +184,10 @@ class PlotStuff {
           colormap(DefaultColors()),
           plotoverflow(0),
           make_integral(false),
-          reverse_integral_dir(false)
+          reverse_integral_dir(false),
+          nthreads(1),
+          entriesperjob(0),
+          histcache("")
         {}
 
         void print() {
@@ -195,6 +202,9 @@ class PlotStuff {
             printf("Using sample settings from %s\n",conf.Data());
             printf("Producing %lu plots using trees named %s from files ending with %s in input directory\n",treevars.size(),treename.Data(),treefilesuffix.Data());
             printf("Will apply weight variable: %s\n",wgtvar.Data());
+            if(nthreads > 1) printf("Will process samples on %u threads\n",nthreads);
+            if(entriesperjob > 0) printf("Will split samples into jobs of %lld entries\n",entriesperjob);
+            if(histcache != "") printf("Will reuse unchanged histograms from %s\n",histcache.Data());
           }
           if(source == HISTS) {
             printf("Using sample settings from %s\n",conf.Data());
@@ -242,6 +252,9 @@ class PlotStuff {
     void     plot();
     // Make yields table
     void     tabulate();
+    // Yields and uncertainties per selection (outer) and sample (inner), filled by tabulate, e.g. as datacard inputs
+    const vector<vector<double> >& getYields() const { return yields_; }
+    const vector<vector<double> >& getYieldErrors() const { return yielderrs_; }
 
     // Set plot configuration parameters
     // Conf file to be processed with list of samples
@@ -304,9 +317,33 @@ class PlotStuff {
     void     setPlotOverflow(unsigned int plotoverflow) { config_.plotoverflow = plotoverflow; }
     // Make integral plots. Default integral direction: (value > [cut]).
     void     setIntegral(bool reverse_integral_direction = false) {config_.make_integral = true; config_.reverse_integral_dir = reverse_integral_direction; }
+    // Number of threads on which sample files (or parts of them, see setEntriesPerJob) are processed with TREES. Output is the same as with one thread
+    void     setNThreads(unsigned int nthreads) { config_.nthreads = nthreads; }
+    // Split files with more entries into several jobs, e.g. to use more threads than there are samples. 0 to process each file in one job
+    void     setEntriesPerJob(Long64_t entriesperjob) { config_.entriesperjob = entriesperjob; }
+    // File in which histograms filled from trees are cached, keyed by input file fingerprint, tree, entry range, weight, variable, selection and binning.
+    // Histograms with an unchanged key are read from it instead of the trees, e.g. when only changing the plot style. Delete the file to clean it up
+    void     setHistCache(TString histcache) { config_.histcache = histcache; }
 
   // Helper functions
   private :
+    // Entry range of a tree file of a sample, processed in one go
+    struct TreeJob {
+      unsigned int isam;
+      TString      filename;
+      Long64_t     firstentry;
+      Long64_t     nentries;
+      TreeJob(unsigned int inisam, TString infilename, Long64_t infirstentry, Long64_t innentries) : isam(inisam), filename(infilename), firstentry(infirstentry), nentries(innentries) {}
+    };
+
+    // Files of a sample: <sample><suffix> if it exists, otherwise the <sample>_*<suffix> fragments of a sample with several input files
+    vector<TString> sampleFiles(const Sample* sample, TString suffix);
+    // Split the samples into jobs, one per file, or per entriesperjob entries of a file
+    vector<TreeJob> makeTreeJobs();
+    // Name of the histogram of var for job in the histogram cache
+    TString  histCacheKey(TString fingerprint, const TreeJob& job, const PlotTreeVar& var);
+    // Call work for each job with the tree of the job, on nthreads threads
+    void     runTreeJobs(const vector<TreeJob>& jobs, std::function<void(unsigned int ijob, TTree* tree)> work);
     // Add a data sample
     void     addData(TString dataname) { config_.dataname = dataname; }
     // Add a background sample
@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Fills many histograms from a tree in a single pass, instead of one TTree::Draw per histogram.
+// Every distinct expression (variable, selection, weight) is compiled once into a TTreeFormula and
+// evaluated at most once per entry and instance, however many histograms use it.
+// Histograms are filled like TTree::Draw("varexp>>hist", "wgtvar*(selection)") would fill them:
+// "y:x" for 2D histograms, and for array expressions one fill per instance, with the number of
+// instances given by the shortest variable size array in the expressions of the histogram.
+// Also accumulates yields for any number of selections in the same pass: the selections are
+// evaluated into a bitmask per entry, and the weighted yield and sum of squared weights of every
+// passing selection are added up, as an integral of TTree::Draw("wgtvar", "wgtvar*(selection)").
+//
+//--------------------------------------------------------------------------------------------------
+
+#ifndef TREEHISTFILLER_H
+#define TREEHISTFILLER_H
+
+#include "TString.h"
+#include "TTree.h"
+#include "TH1.h"
+#include "TMath.h"
+#include "map"
+#include "vector"
+
+class TTreeFormula;
+
+class TreeHistFiller {
+
+  public :
+    // Works on a TTree or a TChain. The weight expression applies to every histogram, empty for no weight
+    TreeHistFiller(TTree* tree, TString wgtvar = "");
+    virtual ~TreeHistFiller();
+
+    // Fill hist with varexp for entries passing selection (empty for all). Returns the index of the histogram
+    unsigned int addHist(TH1* hist, TString varexp, TString selection);
+
+    // Loop over nentries entries from firstentry (all by default) and fill all histograms. Returns the number of entries read
+    Long64_t     fill(Long64_t firstentry = 0, Long64_t nentries = -1);
+
+    // Accumulate the yield of entries passing selection (empty for all). Returns the index of the yield
+    unsigned int addYield(TString selection);
+
+    unsigned int getNHists() const { return hists_.size(); }
+    TH1*         getHist(unsigned int ihist) const { return hists_[ihist].hist; }
+    unsigned int getNYields() const { return yieldsels_.size(); }
+    double       getYield(unsigned int iyield) const { return yields_[iyield]; }
+    double       getYieldError(unsigned int iyield) const { return TMath::Sqrt(sumw2_[iyield]); }
+
+    // Split "y:x" into its expressions, ignoring "::" (e.g. in TMath::Abs)
+    static std::vector<TString> splitVarexp(TString varexp);
+
+  protected :
+    // Compiled expression, with the size and the values of the current entry (instance 0 is always evaluated)
+    struct Expr {
+      TTreeFormula*        formula;
+      bool                 isarray;
+      int                  ndata;
+      std::vector<double>  values;
+      std::vector<bool>    evaluated;
+      Expr() : formula(0), isarray(false), ndata(0) {}
+    };
+
+    struct HistFill {
+      TH1*              hist;
+      std::vector<int>  vars;       // as "y:x", i.e. the last one is along x
+      int               selection;  // -1 if none
+      HistFill() : hist(0), selection(-1) {}
+    };
+
+    int     compile(TString expr);
+    void    loadEntry();
+    double  eval(int iexpr, int instance);
+    int     getNInstances(int selection, const std::vector<int>& vars);
+    void    fillYields();
+
+    TTree*                   tree_;
+    int                      treenumber_;
+    int                      wgt_;
+    std::vector<Expr>        exprs_;
+    std::map<TString, int>   exprindex_;
+    std::vector<HistFill>    hists_;
+    std::vector<int>         yieldsels_;  // -1 if none
+    std::vector<double>      yields_;
+    std::vector<double>      sumw2_;
+    std::vector<ULong64_t>   passmask_;
+
+};
+
+#endif
@@ -5,6 +5,13 @@
 //--------------------------------------------------------------------------------------------------
 
 #include "AnalysisMethods/PlotUtils/interface/PlotStuff.h"
+#include "AnalysisMethods/PlotUtils/interface/TreeHistFiller.h"
+#include "AnalysisTools/Utilities/interface/FileFingerprint.h"
+#include "AnalysisTools/Utilities/interface/RunParallel.h"
+#include "TROOT.h"
+#include "TList.h"
+#include "algorithm"
+#include "mutex"
 
 //using namespace std;
 
@@ -106,84 +113,212 @@ void PlotStuff::addSelection(TString label, TString selection)
 
 }
 
-void PlotStuff::loadPlots()
+vector<TString> PlotStuff::sampleFiles(const Sample* sample, TString suffix)
 {
 
-  switch (config_.source) {
+  TString filename = inputdir_ + "/" + sample->name + suffix;
+  if(sample->filenames.size() <= 1 || !gSystem->AccessPathName(filename.Data()))
+    return vector<TString>(1, filename);
+
+  // the <sample>_*<suffix> fragments
+  vector<TString> filenames;
+  TRegexp pattern(sample->name + "_*" + suffix, kTRUE);
+  void* dir = gSystem->OpenDirectory(inputdir_);
+  assert(dir);
+  while(const char* entry = gSystem->GetDirEntry(dir)) {
+    TString name(entry);
+    Ssiz_t length = 0;
+    if(pattern.Index(name, &length) == 0 && length == name.Length())
+      filenames.push_back(inputdir_ + "/" + name);
+  }
+  gSystem->FreeDirectory(dir);
+  sort(filenames.begin(), filenames.end());
 
-    case TREES : {
+  if(filenames.empty()) {
+    printf("No files found for sample %s!\n", sample->name.Data());
+    assert(false);
+  }
 
-      vector<TH1F*> tmphistsv;
-      vector<TH2F*> tmphists2dv;
+  return filenames;
 
-      TFile *infile = 0;
-      TTree *intree = 0;
+}
 
-      bool firsthist = true;
-      bool first2dhist = true;
+vector<PlotStuff::TreeJob> PlotStuff::makeTreeJobs()
+{
 
-      for(auto* sample : samples_) {
-        tmphistsv.clear();
-        tmphists2dv.clear();
+  vector<TreeJob> jobs;
 
-        TString filename = inputdir_ + "/" + sample->name + config_.treefilesuffix;
+  for(unsigned int isam = 0; isam < samples_.size(); ++isam) {
+    for(auto& filename : sampleFiles(samples_[isam], config_.treefilesuffix)) {
+      Long64_t nentries = -1;
+      if(config_.entriesperjob > 0) {
+        TFile* infile = TFile::Open(filename);
+        assert(infile);
+        TTree* intree = (TTree*)infile->Get(config_.treename);
+        assert(intree);
+        nentries = intree->GetEntries();
+        infile->Close();
+        delete infile;
+      }
 
-        if(sample->filenames.size() > 1 && gSystem->AccessPathName(filename.Data())) {
-          TString cmd = TString::Format("hadd -f %s/%s%s %s/%s_*%s", inputdir_.Data(), sample->name.Data(), config_.treefilesuffix.Data(), inputdir_.Data(), sample->name.Data(), config_.treefilesuffix.Data());
-          gSystem->Exec(cmd.Data());
-        }
+      if(nentries <= config_.entriesperjob) {
+        jobs.push_back(TreeJob(isam, filename, 0, -1));
+        continue;
+      }
+      for(Long64_t firstentry = 0; firstentry < nentries; firstentry += config_.entriesperjob)
+        jobs.push_back(TreeJob(isam, filename, firstentry, config_.entriesperjob));
+    }
+  }
 
-        infile = TFile::Open(filename);
-        assert(infile);
+  return jobs;
 
-        intree = (TTree*)infile->Get(config_.treename);
-        assert(intree);
+}
+
+TString PlotStuff::histCacheKey(TString fingerprint, const TreeJob& job, const PlotTreeVar& var)
+{
 
+  TString key = TString::Format("%s|%s|%lld|%lld|%s|%s|%s|%d,%.17g,%.17g|%d,%.17g,%.17g", fingerprint.Data(), config_.treename.Data(), job.firstentry, job.nentries,
+                                config_.wgtvar.Data(), var.varname.Data(), var.selection.Data(), var.nbinsx, var.xmin, var.xmax, var.nbinsy, var.ymin, var.ymax);
+
+  return "h" + FileFingerprint::hash(key);
+
+}
+
+void PlotStuff::runTreeJobs(const vector<TreeJob>& jobs, std::function<void(unsigned int ijob, TTree* tree)> work)
+{
+
+  if(config_.nthreads > 1 && jobs.size() > 1)
+    ROOT::EnableThreadSafety();
+
+  ucsbsusy::runParallel(jobs.size(), config_.nthreads, [&](unsigned int ijob) {
+    TFile* infile = TFile::Open(jobs[ijob].filename);
+    assert(infile);
+    TTree* intree = (TTree*)infile->Get(config_.treename);
+    assert(intree);
+    work(ijob, intree);
+    infile->Close();
+    delete infile;
+  });
+
+}
+
+void PlotStuff::loadPlots()
+{
+
+  switch (config_.source) {
+
+    case TREES : {
+
+      vector<TreeJob> jobs = makeTreeJobs();
+
+      // histograms of each sample, in the order of the tree variables
+      vector<vector<TH1*> > samplehists(samples_.size());
+      for(unsigned int isam = 0; isam < samples_.size(); ++isam) {
         for(auto var : config_.treevars) {
-          TString histname = var.name + "_" + sample->name;
-          TString drawstr = var.varname + ">>" + histname;
-          TString cutstr = config_.wgtvar + "*(" + var.selection + ")";
-          if(var.varname.Contains(":")) {
-            TH2F* hist2d = new TH2F(histname, TString("; " + var.label + "; Events"), var.nbinsx, var.xmin, var.xmax, var.nbinsy, var.ymin, var.ymax);
-            hist2d->Sumw2();
-            intree->Draw(drawstr.Data(), cutstr.Data());
-            tmphists2dv.push_back(hist2d);
-            tmphists2dv.back()->SetName(TString::Format("%s_%s",var.name.Data(), sample->name.Data()));
-          } else {
-            TH1F* hist = new TH1F(histname, TString("; " + var.label + "; Events"), var.nbinsx, var.xmin, var.xmax);
-            hist->Sumw2();
-            intree->Draw(drawstr.Data(), cutstr.Data());
-            tmphistsv.push_back(hist);
-            tmphistsv.back()->SetName(TString::Format("%s_%s",var.name.Data(), sample->name.Data()));
-          }
+          TString histname = var.name + "_" + samples_[isam]->name;
+          TH1* hist = 0;
+          if(var.varname.Contains(":"))
+            hist = new TH2F(histname, TString("; " + var.label + "; Events"), var.nbinsx, var.xmin, var.xmax, var.nbinsy, var.ymin, var.ymax);
+          else
+            hist = new TH1F(histname, TString("; " + var.label + "; Events"), var.nbinsx, var.xmin, var.xmax);
+          hist->Sumw2();
+          hist->SetDirectory(0);
+          samplehists[isam].push_back(hist);
         }
+      }
 
-        unsigned int nhist = 0;
-        for(vector<TH1F*>::iterator ihist = tmphistsv.begin(); ihist != tmphistsv.end(); ++ihist) {
-          if(firsthist) {
-            vector<TH1F*> tmpvec(ihist, ihist+1);
-            hists_.push_back(tmpvec);
+      // a sample split into several jobs (several files or entry ranges) is filled into copies, added up in job order afterwards
+      vector<unsigned int> njobs(samples_.size(), 0);
+      for(auto& job : jobs) njobs[job.isam]++;
+      vector<vector<TH1*> > jobhists(jobs.size());
+      for(unsigned int ijob = 0; ijob < jobs.size(); ++ijob) {
+        for(auto* hist : samplehists[jobs[ijob].isam]) {
+          if(njobs[jobs[ijob].isam] == 1) {
+            jobhists[ijob].push_back(hist);
           } else {
-            assert(hists_.size() > nhist);
-            hists_[nhist].push_back(*ihist);
+            TH1* copy = (TH1*)hist->Clone();
+            copy->SetDirectory(0);
+            jobhists[ijob].push_back(copy);
           }
-          nhist++;
         }
+      }
 
-        unsigned int nhist2d = 0;
-        for(vector<TH2F*>::iterator ihist = tmphists2dv.begin(); ihist != tmphists2dv.end(); ++ihist) {
-          if(first2dhist) {
-            vector<TH2F*> tmpvec(ihist, ihist+1);
-            hists2d_.push_back(tmpvec);
-          } else {
-            assert(hists2d_.size() > nhist2d);
-            hists2d_[nhist2d].push_back(*ihist);
+      // histograms already in the cache are taken from there, only jobs with others left are run
+      vector<vector<TString> > cachekeys(jobs.size(), vector<TString>(config_.treevars.size()));
+      vector<vector<bool> >    cached(jobs.size(), vector<bool>(config_.treevars.size(), false));
+      if(config_.histcache != "") {
+        TFile* cachefile = gSystem->AccessPathName(config_.histcache) ? 0 : TFile::Open(config_.histcache, "READ");
+        unsigned int ncached = 0;
+        for(unsigned int ijob = 0; ijob < jobs.size(); ++ijob) {
+          TString fingerprint = FileFingerprint::get(jobs[ijob].filename);
+          for(unsigned int ivar = 0; ivar < config_.treevars.size(); ++ivar) {
+            cachekeys[ijob][ivar] = histCacheKey(fingerprint, jobs[ijob], config_.treevars[ivar]);
+            TH1* cachedhist = cachefile ? (TH1*)cachefile->Get(cachekeys[ijob][ivar]) : 0;
+            if(!cachedhist) continue;
+            jobhists[ijob][ivar]->Add(cachedhist);
+            delete cachedhist;
+            cached[ijob][ivar] = true;
+            ncached++;
           }
-          nhist2d++;
         }
+        if(cachefile) {
+          cachefile->Close();
+          delete cachefile;
+        }
+        if(verbose_) printf("Took %u of %lu histograms from %s\n", ncached, jobs.size()*config_.treevars.size(), config_.histcache.Data());
+      }
 
-        if(firsthist)   firsthist = false;
-        if(first2dhist) first2dhist = false;
+      vector<TreeJob>      todojobs;
+      vector<unsigned int> todoindex;
+      for(unsigned int ijob = 0; ijob < jobs.size(); ++ijob) {
+        if(find(cached[ijob].begin(), cached[ijob].end(), false) == cached[ijob].end()) continue;
+        todojobs.push_back(jobs[ijob]);
+        todoindex.push_back(ijob);
+      }
+
+      // all plots of a job are filled in one pass over the tree
+      mutex compilelock;
+      runTreeJobs(todojobs, [&](unsigned int itodo, TTree* intree) {
+        unsigned int ijob = todoindex[itodo];
+        TreeHistFiller* filler = 0;
+        {
+          lock_guard<mutex> guard(compilelock);
+          filler = new TreeHistFiller(intree, config_.wgtvar);
+          for(unsigned int ivar = 0; ivar < config_.treevars.size(); ++ivar)
+            if(!cached[ijob][ivar]) filler->addHist(jobhists[ijob][ivar], config_.treevars[ivar].varname, config_.treevars[ivar].selection);
+        }
+        filler->fill(jobs[ijob].firstentry, jobs[ijob].nentries);
+        lock_guard<mutex> guard(compilelock);
+        delete filler;
+      });
+
+      if(config_.histcache != "" && !todojobs.empty()) {
+        TFile* cachefile = TFile::Open(config_.histcache, "UPDATE");
+        assert(cachefile);
+        for(auto ijob : todoindex) {
+          for(unsigned int ivar = 0; ivar < config_.treevars.size(); ++ivar)
+            if(!cached[ijob][ivar]) cachefile->WriteTObject(jobhists[ijob][ivar], cachekeys[ijob][ivar], "Overwrite");
+        }
+        cachefile->Close();
+        delete cachefile;
+      }
+
+      for(unsigned int ijob = 0; ijob < jobs.size(); ++ijob) {
+        if(njobs[jobs[ijob].isam] == 1) continue;
+        for(unsigned int ivar = 0; ivar < config_.treevars.size(); ++ivar) {
+          samplehists[jobs[ijob].isam][ivar]->Add(jobhists[ijob][ivar]);
+          delete jobhists[ijob][ivar];
+        }
+      }
+
+      for(unsigned int ivar = 0; ivar < config_.treevars.size(); ++ivar) {
+        if(config_.treevars[ivar].varname.Contains(":")) {
+          hists2d_.push_back(vector<TH2F*>());
+          for(auto& hists : samplehists) hists2d_.back().push_back((TH2F*)hists[ivar]);
+        } else {
+          hists_.push_back(vector<TH1F*>());
+          for(auto& hists : samplehists) hists_.back().push_back((TH1F*)hists[ivar]);
+        }
       }
 
       break;
@@ -207,33 +342,62 @@ void PlotStuff::loadPlots()
         tmphists2dv.clear();
         tmpgraphsv.clear();
 
-        TString filename = inputdir_ + "/" + sample->name + config_.plotfilesuffix;
-
-        if(sample->filenames.size() > 1 && gSystem->AccessPathName(filename.Data())) {
-          TString cmd = TString::Format("hadd -f %s/%s%s %s/%s_*%s", inputdir_.Data(), sample->name.Data(), config_.plotfilesuffix.Data(), inputdir_.Data(), sample->name.Data(), config_.plotfilesuffix.Data());
-          gSystem->Exec(cmd.Data());
-        }
-
-        infile = TFile::Open(filename);
-        assert(infile);
-
-        TIter nextkey(gDirectory->GetListOfKeys());
-        while(TKey *key = (TKey*)nextkey()) {
-          TObject *obj = key->ReadObj();
-          if(obj->IsA() == TH1F::Class()) {
-            tmphistsv.push_back((TH1F*)obj);
-            if(firsthist) histplotnames_.push_back(obj->GetName());
-            tmphistsv.back()->SetName(TString::Format("%s_%s",obj->GetName(), sample->name.Data()));
-          }
-          else if(obj->IsA() == TH2F::Class()) {
-            tmphists2dv.push_back((TH2F*)obj);
-            if(first2dhist) hist2dplotnames_.push_back(obj->GetName());
-            tmphists2dv.back()->SetName(TString::Format("%s_%s",obj->GetName(), sample->name.Data()));
+        // fragments of a sample are added up here instead of being merged into a new file first
+        vector<TString> filenames = sampleFiles(sample, config_.plotfilesuffix);
+        for(unsigned int ifile = 0; ifile < filenames.size(); ++ifile) {
+          infile = TFile::Open(filenames[ifile]);
+          assert(infile);
+
+          unsigned int nhist = 0, nhist2d = 0, ngraph = 0;
+          TIter nextkey(infile->GetListOfKeys());
+          while(TKey *key = (TKey*)nextkey()) {
+            TObject *obj = key->ReadObj();
+            TString objname = TString::Format("%s_%s",obj->GetName(), sample->name.Data());
+            if(obj->IsA() == TH1F::Class()) {
+              if(ifile == 0) {
+                tmphistsv.push_back((TH1F*)obj);
+                if(firsthist) histplotnames_.push_back(obj->GetName());
+                tmphistsv.back()->SetName(objname);
+              } else {
+                assert(tmphistsv.size() > nhist && objname == tmphistsv[nhist]->GetName());
+                tmphistsv[nhist]->Add((TH1F*)obj);
+                delete obj;
+              }
+              nhist++;
+            }
+            else if(obj->IsA() == TH2F::Class()) {
+              if(ifile == 0) {
+                tmphists2dv.push_back((TH2F*)obj);
+                if(first2dhist) hist2dplotnames_.push_back(obj->GetName());
+                tmphists2dv.back()->SetName(objname);
+              } else {
+                assert(tmphists2dv.size() > nhist2d && objname == tmphists2dv[nhist2d]->GetName());
+                tmphists2dv[nhist2d]->Add((TH2F*)obj);
+                delete obj;
+              }
+              nhist2d++;
+            }
+            else if(obj->InheritsFrom(TGraph::Class())) {
+              if(ifile == 0) {
+                tmpgraphsv.push_back((TGraph*)obj);
+                if(firstgraph) graphplotnames_.push_back(obj->GetName());
+                tmpgraphsv.back()->SetName(objname);
+              } else {
+                // as hadd does, points of graphs are appended
+                assert(tmpgraphsv.size() > ngraph && objname == tmpgraphsv[ngraph]->GetName());
+                TList graphlist;
+                graphlist.Add(obj);
+                tmpgraphsv[ngraph]->Merge(&graphlist);
+                delete obj;
+              }
+              ngraph++;
+            }
           }
-          else if(obj->InheritsFrom(TGraph::Class())) {
-            tmpgraphsv.push_back((TGraph*)obj);
-            if(firstgraph) graphplotnames_.push_back(obj->GetName());
-            tmpgraphsv.back()->SetName(TString::Format("%s_%s",obj->GetName(), sample->name.Data()));
+
+          // objects of the first file stay attached to it
+          if(ifile > 0) {
+            infile->Close();
+            delete infile;
           }
         }
 
@@ -349,66 +513,44 @@ void PlotStuff::loadTables()
 
     case TREES : {
 
-      vector<double> tmpyieldsv;
-      vector<double> tmpyielderrsv;
-
-      TFile *infile = 0;
-      TTree *intree = 0;
-
-      bool first = true;
-
-      for(auto* sample : samples_) {
-        tmpyieldsv.clear();
-        tmpyielderrsv.clear();
-
-        TString filename = inputdir_ + "/" + sample->name + config_.treefilesuffix;
-
-        if(sample->filenames.size() > 1 && gSystem->AccessPathName(filename.Data())) {
-          TString cmd = TString::Format("hadd -f %s/%s%s %s/%s_*%s", inputdir_.Data(), sample->name.Data(), config_.treefilesuffix.Data(), inputdir_.Data(), sample->name.Data(), config_.treefilesuffix.Data());
-          gSystem->Exec(cmd.Data());
-        }
+      vector<TreeJob> jobs = makeTreeJobs();
 
-        infile = TFile::Open(filename);
-        assert(infile);
+      vector<vector<double> > jobyields(jobs.size());
+      vector<vector<double> > jobsumw2(jobs.size());
 
-        intree = (TTree*)infile->Get(config_.treename);
-        assert(intree);
-
-        for(auto sel : config_.tablesels) {
-          TString drawstr = config_.wgtvar + ">>htmp";
-          TString cutstr = config_.wgtvar + "*(" + sel + ")";
-          intree->Draw(drawstr.Data(), cutstr.Data(), "e");
-          TH1F* htmp = (TH1F*)gPad->GetPrimitive("htmp");
-          double tmperr = 0.0;
-          tmpyieldsv.push_back(htmp->IntegralAndError(0, htmp->GetNbinsX()+1, tmperr));
-          tmpyielderrsv.push_back(tmperr);
+      // all selections of a job are evaluated in one pass over the tree
+      mutex compilelock;
+      runTreeJobs(jobs, [&](unsigned int ijob, TTree* intree) {
+        TreeHistFiller* filler = 0;
+        {
+          lock_guard<mutex> guard(compilelock);
+          filler = new TreeHistFiller(intree, config_.wgtvar);
+          for(auto sel : config_.tablesels)
+            filler->addYield(sel);
         }
-
-        unsigned int nsel = 0;
-        for(vector<double>::iterator iy = tmpyieldsv.begin(); iy != tmpyieldsv.end(); ++iy) {
-          if(first) {
-            vector<double> tmpvec(iy, iy+1);
-            yields_.push_back(tmpvec);
-          } else {
-            assert(yields_.size() > nsel);
-            yields_[nsel].push_back(*iy);
-          }
-          nsel++;
+        filler->fill(jobs[ijob].firstentry, jobs[ijob].nentries);
+        for(unsigned int isel = 0; isel < filler->getNYields(); ++isel) {
+          jobyields[ijob].push_back(filler->getYield(isel));
+          jobsumw2[ijob].push_back(filler->getYieldError(isel)*filler->getYieldError(isel));
         }
-
-        nsel = 0;
-        for(vector<double>::iterator ie = tmpyielderrsv.begin(); ie != tmpyielderrsv.end(); ++ie) {
-          if(first) {
-            vector<double> tmpvec(ie, ie+1);
-            yielderrs_.push_back(tmpvec);
-          } else {
-            assert(yielderrs_.size() > nsel);
-            yielderrs_[nsel].push_back(*ie);
-          }
-          nsel++;
+        lock_guard<mutex> guard(compilelock);
+        delete filler;
+      });
+
+      // jobs of a sample are added up in job order
+      yields_.assign(config_.tablesels.size(), vector<double>(samples_.size(), 0.0));
+      vector<vector<double> > sumw2(config_.tablesels.size(), vector<double>(samples_.size(), 0.0));
+      for(unsigned int ijob = 0; ijob < jobs.size(); ++ijob) {
+        for(unsigned int isel = 0; isel < config_.tablesels.size(); ++isel) {
+          yields_[isel][jobs[ijob].isam] += jobyields[ijob][isel];
+          sumw2[isel][jobs[ijob].isam]   += jobsumw2[ijob][isel];
         }
+      }
 
-        if(first) first = false;
+      yielderrs_.assign(config_.tablesels.size(), vector<double>(samples_.size(), 0.0));
+      for(unsigned int isel = 0; isel < config_.tablesels.size(); ++isel) {
+        for(unsigned int isam = 0; isam < samples_.size(); ++isam)
+          yielderrs_[isel][isam] = sqrt(sumw2[isel][isam]);
       }
 
       break;
@@ -0,0 +1,243 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Fills many histograms and yields from a tree in a single pass.
+//
+//--------------------------------------------------------------------------------------------------
+
+#include "AnalysisMethods/PlotUtils/interface/TreeHistFiller.h"
+#include "TTreeFormula.h"
+#include "TH2.h"
+#include "assert.h"
+#include "algorithm"
+
+using namespace std;
+
+TreeHistFiller::TreeHistFiller(TTree* tree, TString wgtvar) :
+  tree_(tree),
+  treenumber_(-1),
+  wgt_(-1)
+{
+
+  assert(tree_);
+
+  // a chain needs its first tree loaded for the formulas to be compiled
+  tree_->LoadTree(0);
+  treenumber_ = tree_->GetTreeNumber();
+
+  if(wgtvar != "")
+    wgt_ = compile(wgtvar);
+
+}
+
+TreeHistFiller::~TreeHistFiller()
+{
+
+  for(auto& expr : exprs_)
+    delete expr.formula;
+
+}
+
+vector<TString> TreeHistFiller::splitVarexp(TString varexp)
+{
+
+  vector<TString> vars;
+  int start = 0;
+  for(int ichar = 0; ichar < varexp.Length(); ++ichar) {
+    if(varexp[ichar] != ':') continue;
+    if(ichar+1 < varexp.Length() && varexp[ichar+1] == ':') { ++ichar; continue; }
+    vars.push_back(varexp(start, ichar-start));
+    start = ichar+1;
+  }
+  vars.push_back(varexp(start, varexp.Length()-start));
+
+  return vars;
+
+}
+
+int TreeHistFiller::compile(TString expr)
+{
+
+  expr = expr.Strip(TString::kBoth);
+
+  auto found = exprindex_.find(expr);
+  if(found != exprindex_.end()) return found->second;
+
+  Expr newexpr;
+  newexpr.formula = new TTreeFormula(TString::Format("expr%lu", exprs_.size()), expr, tree_);
+  if(newexpr.formula->GetNdim() == 0) {
+    printf("TreeHistFiller: could not compile \"%s\"!\n", expr.Data());
+    assert(false);
+  }
+  newexpr.isarray = newexpr.formula->GetMultiplicity() != 0;
+
+  exprs_.push_back(newexpr);
+  exprindex_[expr] = exprs_.size()-1;
+
+  return exprs_.size()-1;
+
+}
+
+unsigned int TreeHistFiller::addHist(TH1* hist, TString varexp, TString selection)
+{
+
+  assert(hist);
+
+  HistFill fill;
+  fill.hist = hist;
+  for(auto var : splitVarexp(varexp))
+    fill.vars.push_back(compile(var));
+  if(int(fill.vars.size()) != hist->GetDimension()) {
+    printf("TreeHistFiller: \"%s\" does not match the dimension of %s!\n", varexp.Data(), hist->GetName());
+    assert(false);
+  }
+  if(selection.Strip(TString::kBoth) != "")
+    fill.selection = compile(selection);
+
+  hists_.push_back(fill);
+
+  return hists_.size()-1;
+
+}
+
+unsigned int TreeHistFiller::addYield(TString selection)
+{
+
+  yieldsels_.push_back(selection.Strip(TString::kBoth) != "" ? compile(selection) : -1);
+  yields_.push_back(0);
+  sumw2_.push_back(0);
+  passmask_.resize((yieldsels_.size()+63)/64);
+
+  return yieldsels_.size()-1;
+
+}
+
+void TreeHistFiller::loadEntry()
+{
+
+  // like TSelectorDraw, evaluate instance 0 of every formula: only then are its branches read for this
+  // entry, the other instances (and scalar leaves) would otherwise use the values of a previous entry
+  for(unsigned int iexpr = 0; iexpr < exprs_.size(); ++iexpr) {
+    Expr& expr = exprs_[iexpr];
+    expr.evaluated.assign(expr.evaluated.size(), false);
+    expr.ndata = expr.formula->GetNdata();
+    eval(iexpr, 0);
+  }
+
+}
+
+double TreeHistFiller::eval(int iexpr, int instance)
+{
+
+  Expr& expr = exprs_[iexpr];
+  if(instance >= int(expr.values.size())) {
+    expr.values.resize(instance+1);
+    expr.evaluated.resize(instance+1, false);
+  }
+  if(!expr.evaluated[instance]) {
+    expr.values[instance] = expr.formula->EvalInstance(instance);
+    expr.evaluated[instance] = true;
+  }
+
+  return expr.values[instance];
+
+}
+
+int TreeHistFiller::getNInstances(int selection, const vector<int>& vars)
+{
+
+  // the sizes were taken in loadEntry()
+  int ninstances = -1;
+  auto count = [&](int iexpr) {
+    const Expr& expr = exprs_[iexpr];
+    if(expr.isarray && (ninstances < 0 || expr.ndata < ninstances)) ninstances = expr.ndata;
+  };
+
+  if(wgt_ >= 0) count(wgt_);
+  if(selection >= 0) count(selection);
+  for(auto var : vars) count(var);
+
+  return ninstances < 0 ? 1 : ninstances;
+
+}
+
+void TreeHistFiller::fillYields()
+{
+
+  static const vector<int> novars;
+
+  passmask_.assign(passmask_.size(), 0);
+
+  // scalar selections go into the mask, selections on arrays are added per instance right away
+  // (the weight can be evaluated at any instance, loadEntry() already read its branches)
+  for(unsigned int iyield = 0; iyield < yieldsels_.size(); ++iyield) {
+    int sel = yieldsels_[iyield];
+    if(sel < 0 || (!exprs_[sel].isarray && (wgt_ < 0 || !exprs_[wgt_].isarray))) {
+      if(sel < 0 || (getNInstances(sel, novars) > 0 && eval(sel, 0) != 0))
+        passmask_[iyield/64] |= ULong64_t(1) << (iyield%64);
+      continue;
+    }
+    int ninstances = getNInstances(sel, novars);
+    for(int inst = 0; inst < ninstances; ++inst) {
+      double weight = eval(sel, inst);
+      if(weight == 0) continue;
+      if(wgt_ >= 0) weight *= eval(wgt_, inst);
+      yields_[iyield] += weight;
+      sumw2_[iyield]  += weight*weight;
+    }
+  }
+
+  double wgt = 1.0;
+  if(wgt_ >= 0) {
+    bool passany = false;
+    for(auto word : passmask_) passany |= word != 0;
+    if(!passany || getNInstances(-1, novars) == 0) return;
+    wgt = eval(wgt_, 0);
+  }
+
+  for(unsigned int iword = 0; iword < passmask_.size(); ++iword) {
+    for(ULong64_t word = passmask_[iword]; word; word &= word-1) {
+      unsigned int iyield = 64*iword + __builtin_ctzll(word);
+      double weight = yieldsels_[iyield] >= 0 ? wgt*eval(yieldsels_[iyield], 0) : wgt;
+      yields_[iyield] += weight;
+      sumw2_[iyield]  += weight*weight;
+    }
+  }
+
+}
+
+Long64_t TreeHistFiller::fill(Long64_t firstentry, Long64_t nentries)
+{
+
+  Long64_t lastentry = tree_->GetEntries();
+  if(nentries >= 0) lastentry = min(lastentry, firstentry + nentries);
+
+  Long64_t nread = 0;
+  for(Long64_t ientry = firstentry; ientry < lastentry; ++ientry) {
+    if(tree_->LoadTree(ientry) < 0) break;
+    if(tree_->GetTreeNumber() != treenumber_) {
+      treenumber_ = tree_->GetTreeNumber();
+      for(auto& expr : exprs_) expr.formula->UpdateFormulaLeaves();
+    }
+    loadEntry();
+    ++nread;
+
+    if(!yieldsels_.empty()) fillYields();
+
+    for(auto& fill : hists_) {
+      int ninstances = getNInstances(fill.selection, fill.vars);
+      for(int inst = 0; inst < ninstances; ++inst) {
+        double weight = fill.selection >= 0 ? eval(fill.selection, inst) : 1.0;
+        if(weight == 0) continue;
+        if(wgt_ >= 0) weight *= eval(wgt_, inst);
+        if(weight == 0) continue;
+        if(fill.vars.size() == 1)
+          fill.hist->Fill(eval(fill.vars[0], inst), weight);
+        else
+          ((TH2*)fill.hist)->Fill(eval(fill.vars[1], inst), eval(fill.vars[0], inst), weight);
+      }
+    }
+  }
+
+  return nread;
+
+}
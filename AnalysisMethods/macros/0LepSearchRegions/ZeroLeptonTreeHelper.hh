@@ -26,56 +26,110 @@ cfgSet::ConfigSet pars0LepPhoton() {
 }
 
 
+// Columns of the zero-lepton trees, in branch order
+namespace ZeroLeptonColumns {
+  TREE_COLUMN(run,          unsigned int, 0)
+  TREE_COLUMN(lumi,         unsigned int, 0)
+  TREE_COLUMN(event,        unsigned int, 0)
+  TREE_COLUMN(weight,       float       , 0)
+  TREE_COLUMN(genmet,       float       , 0)
+  TREE_COLUMN(bosonpt,      float       , 0)
+  TREE_COLUMN(bosoneta,     float       , 0)
+  TREE_COLUMN(met,          float       , 0)
+  TREE_COLUMN(metphi,       float       , 0)
+  TREE_COLUMN(npv,          int         , 0)
+  TREE_COLUMN(nvetotau,     int         , 0)
+  TREE_COLUMN(nvetolep,     int         , 0)
+  TREE_COLUMN(nsellep,      int         , 0)
+  TREE_COLUMN(nctt,         int         , 0)
+  TREE_COLUMN(ncttstd,      int         , 0)
+  TREE_COLUMN(ngenjets,     int         , 0)
+  TREE_COLUMN(ngenbjets,    int         , 0)
+  TREE_COLUMN(njets,        int         , 0)
+  TREE_COLUMN(njets60,      int         , 0)
+  TREE_COLUMN(nbjets,       int         , 0)
+  TREE_COLUMN(ntbjets,      int         , 0)
+  TREE_COLUMN(ht,           float       , 0)
+  TREE_COLUMN(j1pt,         float       , 0)
+  TREE_COLUMN(j1eta,        float       , 0)
+  TREE_COLUMN(j2pt,         float       , 0)
+  TREE_COLUMN(j2eta,        float       , 0)
+  TREE_COLUMN(j3pt,         float       , 0)
+  TREE_COLUMN(j3eta,        float       , 0)
+  TREE_COLUMN(csvj1pt,      float       , 0)
+  TREE_COLUMN(csvj1eta,     float       , 0)
+  TREE_COLUMN(csvj2pt,      float       , 0)
+  TREE_COLUMN(csvj2eta,     float       , 0)
+  TREE_COLUMN(dphij1met,    float       , 0)
+  TREE_COLUMN(dphij2met,    float       , 0)
+  TREE_COLUMN(dphij12met,   float       , 0)
+  TREE_COLUMN(dphij3met,    float       , 3)
+  TREE_COLUMN(mtcsv1met,    float       , 0)
+  TREE_COLUMN(mtcsv2met,    float       , 0)
+  TREE_COLUMN(mtcsv12met,   float       , 0)
+  TREE_COLUMN(dphicsv1met,  float       , 0)
+  TREE_COLUMN(dphicsv2met,  float       , 0)
+  TREE_COLUMN(dphicsv12met, float       , 0)
+  TREE_COLUMN(leptonpt,     float       , 0)
+  TREE_COLUMN(leptoneta,    float       , 0)
+  TREE_COLUMN(mtlepmet,     float       , 0)
+  TREE_COLUMN(absdphilepw,  float       , 0)
+}
+
 struct TreeFiller {
 
   TreeFiller() {}
 
-  size i_run       ;
-  size i_lumi      ;
-  size i_event     ;
-  size i_weight    ;
-  size i_genmet    ;
-  size i_bosonpt   ;
-  size i_bosoneta  ;
-  size i_met       ;
-  size i_metphi    ;
-  size i_npv       ;
-  size i_nvetotau  ;
-  size i_nvetolep  ;
-  size i_nsellep   ;
-  size i_nctt      ;
-  size i_ncttstd   ;
-  size i_ngenjets  ;
-  size i_ngenbjets ;
-  size i_njets     ;
-  size i_njets60   ;
-  size i_nbjets    ;
-  size i_ntbjets   ;
-  size i_ht        ;
-  size i_j1pt      ;
-  size i_j1eta     ;
-  size i_j2pt      ;
-  size i_j2eta     ;
-  size i_j3pt      ;
-  size i_j3eta     ;
-  size i_csvj1pt   ;
-  size i_csvj1eta  ;
-  size i_csvj2pt   ;
-  size i_csvj2eta  ;
-  size i_dphij1met ;
-  size i_dphij2met ;
-  size i_dphij12met;
-  size i_dphij3met ;
-  size i_mtcsv1met ;
-  size i_mtcsv2met ;
-  size i_mtcsv12met;
-  size i_dphicsv1met;
-  size i_dphicsv2met;
-  size i_dphicsv12met;
-  size i_absdphilepw;
-  size i_leptonpt  ;
-  size i_leptoneta ;
-  size i_mtlepmet  ;
+  typedef TreeSchema<
+    ZeroLeptonColumns::run,
+    ZeroLeptonColumns::lumi,
+    ZeroLeptonColumns::event,
+    ZeroLeptonColumns::weight,
+    ZeroLeptonColumns::genmet,
+    ZeroLeptonColumns::bosonpt,
+    ZeroLeptonColumns::bosoneta,
+    ZeroLeptonColumns::met,
+    ZeroLeptonColumns::metphi,
+    ZeroLeptonColumns::npv,
+    ZeroLeptonColumns::nvetotau,
+    ZeroLeptonColumns::nvetolep,
+    ZeroLeptonColumns::nsellep,
+    ZeroLeptonColumns::nctt,
+    ZeroLeptonColumns::ncttstd,
+    ZeroLeptonColumns::ngenjets,
+    ZeroLeptonColumns::ngenbjets,
+    ZeroLeptonColumns::njets,
+    ZeroLeptonColumns::njets60,
+    ZeroLeptonColumns::nbjets,
+    ZeroLeptonColumns::ntbjets,
+    ZeroLeptonColumns::ht,
+    ZeroLeptonColumns::j1pt,
+    ZeroLeptonColumns::j1eta,
+    ZeroLeptonColumns::j2pt,
+    ZeroLeptonColumns::j2eta,
+    ZeroLeptonColumns::j3pt,
+    ZeroLeptonColumns::j3eta,
+    ZeroLeptonColumns::csvj1pt,
+    ZeroLeptonColumns::csvj1eta,
+    ZeroLeptonColumns::csvj2pt,
+    ZeroLeptonColumns::csvj2eta,
+    ZeroLeptonColumns::dphij1met,
+    ZeroLeptonColumns::dphij2met,
+    ZeroLeptonColumns::dphij12met,
+    ZeroLeptonColumns::dphij3met,
+    ZeroLeptonColumns::mtcsv1met,
+    ZeroLeptonColumns::mtcsv2met,
+    ZeroLeptonColumns::mtcsv12met,
+    ZeroLeptonColumns::dphicsv1met,
+    ZeroLeptonColumns::dphicsv2met,
+    ZeroLeptonColumns::dphicsv12met,
+    ZeroLeptonColumns::leptonpt,
+    ZeroLeptonColumns::leptoneta,
+    ZeroLeptonColumns::mtlepmet,
+    ZeroLeptonColumns::absdphilepw
+  > Schema;
+  Schema schema;
+
 
 /*  bool passCTTSelection(CMSTopF* ctt) {
     return (ctt->topRawMass() > 140.0 && ctt->topRawMass() < 250.0 && ctt->topMinMass() > 50.0 && ctt->topNsubJets() >= 3);
@@ -102,104 +156,58 @@ struct TreeFiller {
   }
 
   void book(TreeWriterData* data) {
-    i_run        = data->add<unsigned int>("","run","i",0);
-    i_lumi       = data->add<unsigned int>("","lumi","i",0);
-    i_event      = data->add<unsigned int>("","event","i",0);
-    i_weight     = data->add<float>("","weight","F",0);
-    i_genmet     = data->add<float>("","genmet","F",0);
-    i_bosonpt    = data->add<float>("","bosonpt","F",0);
-    i_bosoneta   = data->add<float>("","bosoneta","F",0);
-    i_met        = data->add<float>("","met","F",0);
-    i_metphi     = data->add<float>("","metphi","F",0);
-    i_npv        = data->add<int>("","npv","I",0);
-    i_nvetotau   = data->add<int>("","nvetotau","I",0);
-    i_nvetolep   = data->add<int>("","nvetolep","I",0);
-    i_nsellep   = data->add<int>("","nsellep","I",0);
-    i_nctt       = data->add<int>("","nctt","I",0);
-    i_ncttstd    = data->add<int>("","ncttstd","I",0);
-    i_ngenjets   = data->add<int>("","ngenjets","I",0);
-    i_ngenbjets  = data->add<int>("","ngenbjets","I",0);
-    i_njets      = data->add<int>("","njets","I",0);
-    i_njets60    = data->add<int>("","njets60","I",0);
-    i_nbjets     = data->add<int>("","nbjets","I",0);
-    i_ntbjets    = data->add<int>("","ntbjets","I",0);
-    i_ht         = data->add<float>("","ht","F",0);
-    i_j1pt       = data->add<float>("","j1pt","F",0);
-    i_j1eta      = data->add<float>("","j1eta","F",0);
-    i_j2pt       = data->add<float>("","j2pt","F",0);
-    i_j2eta      = data->add<float>("","j2eta","F",0);
-    i_j3pt       = data->add<float>("","j3pt","F",0);
-    i_j3eta      = data->add<float>("","j3eta","F",0);
-    i_csvj1pt    = data->add<float>("","csvj1pt","F",0);
-    i_csvj1eta   = data->add<float>("","csvj1eta","F",0);
-    i_csvj2pt    = data->add<float>("","csvj2pt","F",0);
-    i_csvj2eta   = data->add<float>("","csvj2eta","F",0);
-    i_dphij1met  = data->add<float>("","dphij1met","F",0);
-    i_dphij2met  = data->add<float>("","dphij2met","F",0);
-    i_dphij12met = data->add<float>("","dphij12met","F",0);
-    i_dphij3met  = data->add<float>("","dphij3met","F",3);
-    i_mtcsv1met  = data->add<float>("","mtcsv1met","F",0);
-    i_mtcsv2met  = data->add<float>("","mtcsv2met","F",0);
-    i_mtcsv12met   = data->add<float>("","mtcsv12met","F",0);
-    i_dphicsv1met   = data->add<float>("","dphicsv1met","F",0);
-    i_dphicsv2met   = data->add<float>("","dphicsv2met","F",0);
-    i_dphicsv12met   = data->add<float>("","dphicsv12met","F",0);
-    i_leptonpt   = data->add<float>("","leptonpt","F",0);
-    i_leptoneta  = data->add<float>("","leptoneta","F",0);
-    i_mtlepmet   = data->add<float>("","mtlepmet","F",0);
-    i_absdphilepw = data->add<float>("","absdphilepw","F",0);
-
+    data->attach(&schema);
   }
 
   void fillEventInfo(TreeWriterData* data, BaseTreeAnalyzer* ana,  int randomLepton = 0, bool lepAddedBack = false, MomentumF* metn = 0) {
-    data->fill<unsigned int>(i_run, ana->run);
-    data->fill<unsigned int>(i_lumi, ana->lumi);
-    data->fill<unsigned int>(i_event, ana->event);
-    data->fill<float>(i_weight, ana->weight);
-    data->fill<float>(i_genmet, ana->genmet->pt());
+    schema.fill<ZeroLeptonColumns::run>(ana->run);
+    schema.fill<ZeroLeptonColumns::lumi>(ana->lumi);
+    schema.fill<ZeroLeptonColumns::event>(ana->event);
+    schema.fill<ZeroLeptonColumns::weight>(ana->weight);
+    schema.fill<ZeroLeptonColumns::genmet>(ana->genmet->pt());
     if(!lepAddedBack)
     {
-    data->fill<float>(i_met, ana->met->pt());
-    data->fill<float>(i_metphi, ana->met->phi());
+    schema.fill<ZeroLeptonColumns::met>(ana->met->pt());
+    schema.fill<ZeroLeptonColumns::metphi>(ana->met->phi());
     }
     else
     {
-    data->fill<float>(i_met, metn->pt());
-    data->fill<float>(i_metphi, metn->phi());
+    schema.fill<ZeroLeptonColumns::met>(metn->pt());
+    schema.fill<ZeroLeptonColumns::metphi>(metn->phi());
     }
-    data->fill<int  >(i_npv, ana->nPV);
-    data->fill<int  >(i_nvetotau, ana->nVetoedTracks);
-    data->fill<int  >(i_nvetolep, ana->nVetoedLeptons);
-    data->fill<int  >(i_nsellep, ana->nSelLeptons);
-    data->fill<int  >(i_nctt, ana->cttTops.size());
+    schema.fill<ZeroLeptonColumns::npv>(ana->nPV);
+    schema.fill<ZeroLeptonColumns::nvetotau>(ana->nVetoedTracks);
+    schema.fill<ZeroLeptonColumns::nvetolep>(ana->nVetoedLeptons);
+    schema.fill<ZeroLeptonColumns::nsellep>(ana->nSelLeptons);
+    schema.fill<ZeroLeptonColumns::nctt>(int(ana->cttTops.size()));
     int ncttstd = 0;
     for(auto* ctt : ana->cttTops) {
       if(passCTTSelection(ctt)) ncttstd++;
     }
-    data->fill<int  >(i_ncttstd, ncttstd);
+    schema.fill<ZeroLeptonColumns::ncttstd>(ncttstd);
     if(ana->nSelLeptons > 0)
     {
     MomentumF* lep = new MomentumF(ana->selectedLeptons.at(randomLepton)->p4());
     MomentumF* W = new MomentumF(ana->selectedLeptons.at(randomLepton)->p4() + ana->met->p4());
-    data->fill<float>(i_absdphilepw, fabs(PhysicsUtilities::deltaPhi(*W, *lep)) );
-    data->fill<float>(i_leptonpt, lep->pt());
-    data->fill<float>(i_leptoneta, lep->eta());
-    data->fill<float>(i_mtlepmet, JetKinematics::transverseMass(*lep, *ana->met));
+    schema.fill<ZeroLeptonColumns::absdphilepw>(float(fabs(PhysicsUtilities::deltaPhi(*W, *lep))) );
+    schema.fill<ZeroLeptonColumns::leptonpt>(lep->pt());
+    schema.fill<ZeroLeptonColumns::leptoneta>(lep->eta());
+    schema.fill<ZeroLeptonColumns::mtlepmet>(float(JetKinematics::transverseMass(*lep, *ana->met)));
     }
 
   }
 
   void fillGenInfo(TreeWriterData* data, GenParticleF* boson, vector<GenJetF*> genjets, bool cleanjetsvboson = true) {
-    data->fill<float>(i_bosonpt, boson->pt());
-    data->fill<float>(i_bosoneta, boson->eta());
+    schema.fill<ZeroLeptonColumns::bosonpt>(boson->pt());
+    schema.fill<ZeroLeptonColumns::bosoneta>(boson->eta());
     int ngenjets = 0, ngenbjets = 0;
     for(auto* j : genjets) {
       if(cleanjetsvboson && PhysicsUtilities::deltaR2(*j, *boson) < 0.16) continue;
       ngenjets++;
       if(fabs(j->flavor()) == JetFlavorInfo::b_jet) ngenbjets++;
     }
-    data->fill<int  >(i_ngenjets, ngenjets);
-    data->fill<int  >(i_ngenbjets, ngenbjets);
+    schema.fill<ZeroLeptonColumns::ngenjets>(ngenjets);
+    schema.fill<ZeroLeptonColumns::ngenbjets>(ngenbjets);
   }
 
   void fillJetInfo(TreeWriterData* data, vector<RecoJetF*> jets, vector<RecoJetF*> bjets, MomentumF* met) {
@@ -211,32 +219,32 @@ struct TreeFiller {
     for(auto* b : bjets) {
       if(b->csv() > defaults::CSV_TIGHT) ntbjets++;
     }
-    data->fill<int>(i_njets, int(jets.size()));
-    data->fill<int>(i_njets60, njets60);
-    data->fill<int>(i_nbjets, int(bjets.size()));
-    data->fill<int>(i_ntbjets, ntbjets);
-    data->fill<float>(i_ht, JetKinematics::ht(jets, 20.0, 2.4));
+    schema.fill<ZeroLeptonColumns::njets>(int(jets.size()));
+    schema.fill<ZeroLeptonColumns::njets60>(njets60);
+    schema.fill<ZeroLeptonColumns::nbjets>(int(bjets.size()));
+    schema.fill<ZeroLeptonColumns::ntbjets>(ntbjets);
+    schema.fill<ZeroLeptonColumns::ht>(float(JetKinematics::ht(jets, 20.0, 2.4)));
 
     float dphij1met = 0.0, dphij2met = 0.0;
     if(jets.size() > 0) {
-      data->fill<float>(i_j1pt, jets[0]->pt());
-      data->fill<float>(i_j1eta, jets[0]->eta());
+      schema.fill<ZeroLeptonColumns::j1pt>(jets[0]->pt());
+      schema.fill<ZeroLeptonColumns::j1eta>(jets[0]->eta());
       dphij1met = fabs(PhysicsUtilities::deltaPhi(*jets[0], *met));
-      data->fill<float>(i_dphij1met, dphij1met);
+      schema.fill<ZeroLeptonColumns::dphij1met>(dphij1met);
       if(jets.size() == 1)
-        data->fill<float>(i_dphij12met, dphij1met);
+        schema.fill<ZeroLeptonColumns::dphij12met>(dphij1met);
     }
     if(jets.size() > 1) {
-      data->fill<float>(i_j2pt, jets[1]->pt());
-      data->fill<float>(i_j2eta, jets[1]->eta());
+      schema.fill<ZeroLeptonColumns::j2pt>(jets[1]->pt());
+      schema.fill<ZeroLeptonColumns::j2eta>(jets[1]->eta());
       dphij2met = fabs(PhysicsUtilities::deltaPhi(*jets[1], *met));
-      data->fill<float>(i_dphij2met, dphij2met);
-      data->fill<float>(i_dphij12met, min(dphij1met,dphij2met));
+      schema.fill<ZeroLeptonColumns::dphij2met>(dphij2met);
+      schema.fill<ZeroLeptonColumns::dphij12met>(min(dphij1met,dphij2met));
     }
     if(jets.size() > 2) {
-      data->fill<float>(i_j3pt, jets[2]->pt());
-      data->fill<float>(i_j3eta, jets[2]->eta());
-      data->fill<float>(i_dphij3met, fabs(PhysicsUtilities::deltaPhi(*jets[2], *met)));
+      schema.fill<ZeroLeptonColumns::j3pt>(jets[2]->pt());
+      schema.fill<ZeroLeptonColumns::j3eta>(jets[2]->eta());
+      schema.fill<ZeroLeptonColumns::dphij3met>(float(fabs(PhysicsUtilities::deltaPhi(*jets[2], *met))));
     }
 
     vector<RecoJetF*> jetsCSVranked;
@@ -246,25 +254,25 @@ struct TreeFiller {
     if(jetsCSVranked.size() > 0) {
       mtcsv1met = JetKinematics::transverseMass(*jetsCSVranked[0], *met);
       dphicsv1met = fabs(PhysicsUtilities::deltaPhi(*jetsCSVranked[0], *met));
-      data->fill<float>(i_mtcsv1met, mtcsv1met);
-      data->fill<float>(i_csvj1pt, jetsCSVranked[0]->pt());
-      data->fill<float>(i_csvj1eta, jetsCSVranked[0]->eta());
-      data->fill<float>(i_dphicsv1met, dphicsv1met);
+      schema.fill<ZeroLeptonColumns::mtcsv1met>(mtcsv1met);
+      schema.fill<ZeroLeptonColumns::csvj1pt>(jetsCSVranked[0]->pt());
+      schema.fill<ZeroLeptonColumns::csvj1eta>(jetsCSVranked[0]->eta());
+      schema.fill<ZeroLeptonColumns::dphicsv1met>(dphicsv1met);
       if(jetsCSVranked.size() == 1) {
-        data->fill<float>(i_mtcsv12met, mtcsv1met);
-        data->fill<float>(i_dphicsv12met, dphicsv1met);
+        schema.fill<ZeroLeptonColumns::mtcsv12met>(mtcsv1met);
+        schema.fill<ZeroLeptonColumns::dphicsv12met>(dphicsv1met);
       }
     }
 
     if(jetsCSVranked.size() > 1) {
       mtcsv2met = JetKinematics::transverseMass(*jetsCSVranked[1], *met);
       dphicsv2met = fabs(PhysicsUtilities::deltaPhi(*jetsCSVranked[1], *met));
-      data->fill<float>(i_csvj2pt, jetsCSVranked[1]->pt());
-      data->fill<float>(i_csvj2eta, jetsCSVranked[1]->eta());
-      data->fill<float>(i_mtcsv2met, mtcsv2met);
-      data->fill<float>(i_mtcsv12met, min(mtcsv1met,mtcsv2met));
-      data->fill<float>(i_dphicsv2met, dphicsv2met);
-      data->fill<float>(i_dphicsv12met,min(dphicsv1met,dphicsv2met));
+      schema.fill<ZeroLeptonColumns::csvj2pt>(jetsCSVranked[1]->pt());
+      schema.fill<ZeroLeptonColumns::csvj2eta>(jetsCSVranked[1]->eta());
+      schema.fill<ZeroLeptonColumns::mtcsv2met>(mtcsv2met);
+      schema.fill<ZeroLeptonColumns::mtcsv12met>(min(mtcsv1met,mtcsv2met));
+      schema.fill<ZeroLeptonColumns::dphicsv2met>(dphicsv2met);
+      schema.fill<ZeroLeptonColumns::dphicsv12met>(min(dphicsv1met,dphicsv2met));
     }
 
   }
@@ -275,18 +283,36 @@ class ZeroLeptonAnalyzer : public TreeCopierManualBranches {
 
   public :
     ZeroLeptonAnalyzer(TString fileName, TString treeName, TString outfileName, bool isMCTree, cfgSet::ConfigSet *pars) :
-      TreeCopierManualBranches(fileName, treeName, outfileName, isMCTree, pars) {}
+      TreeCopierManualBranches(fileName, treeName, outfileName, isMCTree, pars), fastReadOutput_(false) {}
 
     const double metcut_ = 175.0 ;
 
     TreeFiller filler;
+    bool       fastReadOutput_;
 
     virtual ~ZeroLeptonAnalyzer() {}
 
+    //for small flat trees that are read many times downstream: LZ4 (zlib 1 before ROOT 6.12), large baskets and a write report
+    void setFastReadOutput(bool fast = true) { fastReadOutput_ = fast; }
+
     void book() {
+      if(fastReadOutput_){
+        if(TreeWriter::isSupported(TreeWriter::LZ4)) treeWriter_->setCompression(TreeWriter::LZ4, 4);
+        else                                         treeWriter_->setCompression(TreeWriter::ZLIB, 1);
+        treeWriter_->setBufSize(256000);
+        treeWriter_->setReport();
+      }
       filler.book(&data);
     }
 
+    //only reads two branches for the rejected events when the reader is lazy
+    bool passPreselection() {
+      if(!access(&evtInfoReader.goodvertex)) return false;
+      //the JES shift changes the met, so only cut on it before the corrections if there is none
+      if(configSet.jets.JES == 0 && access(&evtInfoReader.met_pt) < metcut_) return false;
+      return true;
+    }
+
     bool fillEvent() {
       if(nVetoedLeptons > 0)  return false;
       if(nVetoedTracks > 0)     return false;
@@ -16,23 +16,40 @@
 
 namespace ucsbsusy {
   class TreeReader;
+  class EventArena;
   class BaseReader {
 
     public :
-      BaseReader() : branchName_(""), options_(0), loaded_(false) {};
+      BaseReader() : branchName_(""), options_(0), loaded_(false), treeReader_(0) {};
       virtual ~BaseReader() {};
 
       virtual void load(TreeReader *treeReader, int options, std::string branchName) = 0;
       virtual void refresh() = 0;
+      //Drop everything allocated from the event arena, called before it is reset for the next event
+      virtual void releaseArena() {}
 
       bool isLoaded() const {return loaded_;}
       std::string branchName(){return branchName_;}
       bool hasOption(const int opt) const {return opt & options_;}
+      int  getOptions() const {return options_;}
+
+      //Get one of the reader's branch members, reading the branch first if the TreeReader is lazy
+      //(for use before refresh() is called, e.g. jets.access(jets.jetpt_).size() or evt.access(&evt.met_pt))
+      template<typename varType>
+      varType& access(varType * var) const {readBranch(var); return *var;}
 
     protected:
+      void readBranch(const void * var) const;
+      //per-event scratch memory of the TreeReader (0 if not loaded through one)
+      EventArena * eventArena() const;
+
       const std::string branchName_;  //branch prefix
       const int options_; //filling options
       bool loaded_; //has been loaded
+
+    private:
+      friend class TreeReader;
+      TreeReader * treeReader_; //set when loaded through the TreeReader
   }; //BaseReader
 
 }
@@ -12,11 +12,15 @@
 #define ANALYSISTOOLS_TREEREADER_ELECTRONREADER_H
 
 #include "AnalysisTools/TreeReader/interface/BaseReader.h"
+#include "AnalysisTools/TreeReader/interface/EventArena.h"
 #include "AnalysisTools/DataFormats/interface/Electron.h"
 #include "AnalysisTools/ObjectSelection/interface/LeptonId.h"
 
 namespace ucsbsusy {
 
+  // Collection of the reader, rebuilt in the event arena each event
+  typedef ArenaVector<ElectronF> ElectronFArenaCollection;
+
   class ElectronReader : public BaseReader {
 
     public :
@@ -33,6 +37,7 @@ namespace ucsbsusy {
 
     void load(TreeReader *treeReader, int options, std::string branchName);
     void refresh();
+    void releaseArena();
 
     public :
       std::vector<float> *	pt;
@@ -59,7 +64,7 @@ namespace ucsbsusy {
       std::vector<float> *      ptrel;
       std::vector<float> *      ptratio;
 
-      ElectronFCollection electrons;
+      ElectronFArenaCollection electrons;
 
     private :
       LeptonId* eleId;
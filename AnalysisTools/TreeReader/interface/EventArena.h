@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------------------------------
+//
+// EventArena
+//
+// Monotonic buffer for per-event scratch memory, owned by the TreeReader and reset in one go when
+// the next event is read. Allocating is a pointer bump and freeing does nothing, so temporary
+// containers built while processing an event cost no heap traffic. Nothing allocated from the arena
+// may be kept beyond the event.
+//
+// The reader object collections (recoJets, genJets, electrons, muons, pfcands) are ArenaVectors as
+// well: the TreeReader asks every reader to let go of them (BaseReader::releaseArena()) before the
+// reset, and refresh() rebuilds them from the fresh arena. The gen particles (pointed to by the
+// GenParticles themselves and by TopJetMatching, below the TreeReader) and the analyzer's pointer
+// vectors (jets, bJets, allLeptons, genParts; std::vector<X*> arguments all over the analyses) stay
+// on the heap.
+//
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISTOOLS_TREEREADER_EVENTARENA_H
+#define ANALYSISTOOLS_TREEREADER_EVENTARENA_H
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace ucsbsusy {
+
+  class EventArena {
+  public :
+    explicit EventArena(size_t minBlockSize = 1 << 16);
+    ~EventArena() {}
+
+    void * allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+    template<typename T>
+    T *    allocate(size_t n) { return static_cast<T*>(allocate(n*sizeof(T),alignof(T))); }
+
+    // Free everything allocated since the last reset. When the event did not fit into one block the
+    // blocks are merged into one big enough for it, so the next events only use a single block.
+    void   reset();
+
+    size_t getCapacity()      const { return capacity; }
+    size_t getEventBytes()    const { return eventBytes; }      //allocated since the last reset
+    size_t getLastEventBytes()const { return lastEventBytes; }  //recycled by the last reset
+    double getMeanRecycled()  const { return nResets ? double(totalRecycled)/nResets : 0; }
+    void   print(std::ostream& os = std::clog) const;
+
+  private:
+    struct Block {
+      std::unique_ptr<char[]> data;
+      size_t                  size;
+      Block(size_t s) : data(new char[s]), size(s) {}
+    };
+    void   addBlock(size_t minSize);
+    size_t alignedOffset(size_t alignment) const; //next offset in the last block with the alignment
+
+    const size_t       blockSize;
+    std::vector<Block> blocks;
+    size_t             offset;     //in the last block
+    size_t             capacity;
+    size_t             eventBytes;
+    size_t             lastEventBytes;
+    size_t             totalRecycled;
+    size_t             nResets;
+  };
+
+  // STL allocator drawing from an EventArena, falls back to the heap if no arena is given.
+  // The arena moves along with the storage on swaps and move assignments, while copies of a container
+  // keep (or, when constructed, get) a heap allocator so that they can outlive the event.
+  template<typename T>
+  class ArenaAllocator {
+  public :
+    typedef T              value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator(EventArena * arena = 0) : arena_(arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+    T * allocate(size_t n) {
+      return arena_ ? arena_->allocate<T>(n) : static_cast<T*>(::operator new(n*sizeof(T)));
+    }
+    void deallocate(T * p, size_t) {
+      if(!arena_) ::operator delete(p);
+    }
+    EventArena * arena() const { return arena_; }
+    ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+  private:
+    EventArena * arena_;
+  };
+  template<typename T, typename U>
+  bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() == b.arena(); }
+  template<typename T, typename U>
+  bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() != b.arena(); }
+
+  // Per-event vector, e.g. ArenaVector<bool> veto(n,false,ArenaAllocator<bool>(arena))
+  template<typename T>
+  using ArenaVector = std::vector<T,ArenaAllocator<T> >;
+
+}
+
+#endif
@@ -11,38 +11,55 @@
 #ifndef ANALYSISTOOLS_TREEREADER_EVENTINFOREADER_H
 #define ANALYSISTOOLS_TREEREADER_EVENTINFOREADER_H
 
+#include <type_traits>
 #include "AnalysisTools/TreeReader/interface/BaseReader.h"
 #include "AnalysisTools/DataFormats/interface/Momentum.h"
 #include "AnalysisTools/TreeReader/interface/Defaults.h"
 
 namespace ucsbsusy {
 
-  class EventInfoReader : public BaseReader {
+  // Fixed layout block of the per-event scalars, no larger than a cache line.
+  // The EventInfoReader branches are bound directly into it, so it can be read (or copied for a skim)
+  // as a single object. It is naturally aligned: over-aligning it would make every analyzer
+  // over-aligned, which operator new does not honor before C++17.
+  struct EventHeader {
+    unsigned int  run;
+    unsigned int  lumi;
+    unsigned int  event;
+    unsigned int  nPV;
+    float         rho;
+    float         pvx;
+    float         pvy;
+    float         pvz;
+    float         met_pt;
+    float         met_phi;
+    float         metsumEt;
+    float         genmet_pt;
+    float         genmet_phi;
+    float         weight;
+    bool          goodvertex;
+    size8         proc;
+  };
+  static_assert(sizeof(EventHeader) <= 64, "EventHeader should fit in one cache line");
+  static_assert(std::is_pod<EventHeader>::value, "EventHeader has to stay trivially copyable");
+
+  class EventInfoReader : public BaseReader, public EventHeader {
 
     public :
+      enum  Options           {
+                                NULLOPT         = 0
+                              , HEADERONLY      = (1 <<  0)   ///< Analyzers read header() instead of copying the scalars every event
+      };
+
       EventInfoReader();
       ~EventInfoReader() {}
 
       void	load(TreeReader *treeReader, int options=0, std::string branchName="");
       void	refresh();
 
-      unsigned int  run;
-      unsigned int  lumi;
-      unsigned int  event;
-      unsigned int  nPV;
-      float         rho;
-      float         pvx;
-      float         pvy;
-      float         pvz;
-      float         met_pt;
-      float         met_phi;
-      float         metsumEt;
-      float         genmet_pt;
-      float         genmet_phi;
-      bool          goodvertex;
-      size8             proc;
+      const EventHeader& header() const { return *this; }
+
       defaults::Process process;
-      float             weight;
 
       MomentumF    met;
       MomentumF    genmet;
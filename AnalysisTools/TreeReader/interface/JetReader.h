@@ -13,11 +13,32 @@
 
 
 #include "AnalysisTools/TreeReader/interface/BaseReader.h"
+#include "AnalysisTools/TreeReader/interface/EventArena.h"
 #include "AnalysisTools/DataFormats/interface/Jet.h"
 #include <TRandom3.h>
 
 namespace ucsbsusy {
 
+// Jet collections of the reader, rebuilt in the event arena each event
+typedef ArenaVector<RecoJetF> RecoJetFArenaCollection;
+typedef ArenaVector<GenJetF>  GenJetFArenaCollection;
+
+// Structure-of-arrays view of the reco jets, pointing straight into the branch buffers.
+// Indices are in ntuple order, ptOrder gives them by decreasing pt.
+// Values are the raw ntuple ones (no JES shift or other corrections applied to RecoJetF).
+struct JetColumns {
+  unsigned int             size;
+  const float*             pt;
+  const float*             eta;
+  const float*             phi;
+  const float*             mass;
+  const float*             csv;
+  const std::vector<bool>* looseId;
+  std::vector<size16>      ptOrder;
+
+  JetColumns() : size(0), pt(0), eta(0), phi(0), mass(0), csv(0), looseId(0) {}
+};
+
 class JetReader : public BaseReader {
 public :
   enum  Options           {
@@ -27,6 +48,7 @@ public :
                           , LOADJETSHAPE    = (1 <<  2)   ///< load jet shap variables
                           , LOADTOPASSOC    = (1 <<  3)   ///< load top - jet assoc
                           , FILLOBJ         = (1 <<  4)   ///< Fill objects (as opposed to just pointers
+                          , FILLCOLUMNS     = (1 <<  5)   ///< Fill the columnar view of the reco jets
   };
   static const int defaultOptions;
 
@@ -35,8 +57,11 @@ public :
 
   void load(TreeReader *treeReader, int options, std::string branchName);
   void refresh();
+  void releaseArena();
 
   void pushToTree(); //push changes made to the momentum back to the tree
+protected:
+  void fillColumns();
 public:
   // Members to hold info to be filled in the tree (for now; this implementation is to be updated)
   std::vector<float>* jetpt_;
@@ -81,8 +106,10 @@ public:
 
 
   //the actual jet collection
-  RecoJetFCollection recoJets;
-  GenJetFCollection  genJets;
+  RecoJetFArenaCollection recoJets;
+  GenJetFArenaCollection  genJets;
+  //columnar view, only filled with FILLCOLUMNS
+  JetColumns         columns;
 };
 
 }
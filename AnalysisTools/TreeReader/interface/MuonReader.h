@@ -12,11 +12,15 @@
 #define ANALYSISTOOLS_TREEREADER_MUONREADER_H
 
 #include "AnalysisTools/TreeReader/interface/BaseReader.h"
+#include "AnalysisTools/TreeReader/interface/EventArena.h"
 #include "AnalysisTools/DataFormats/interface/Muon.h"
 #include "AnalysisTools/ObjectSelection/interface/LeptonId.h"
 
 namespace ucsbsusy {
 
+  // Collection of the reader, rebuilt in the event arena each event
+  typedef ArenaVector<MuonF> MuonFArenaCollection;
+
   class MuonReader : public BaseReader {
 
   public :
@@ -34,6 +38,7 @@ namespace ucsbsusy {
 
   void load(TreeReader *treeReader, int options, std::string branchName);
   void refresh();
+  void releaseArena();
 
     public :
       std::vector<float> *   pt;
@@ -57,7 +62,7 @@ namespace ucsbsusy {
       std::vector<float> *	ptrel;
       std::vector<float> *	ptratio;
 
-      MuonFCollection muons;
+      MuonFArenaCollection muons;
 
     private :
       LeptonId* muonId;
@@ -12,11 +12,15 @@
 #define ANALYSISTOOLS_TREEREADER_PFCANDIDATEREADER_H
 
 #include "AnalysisTools/TreeReader/interface/BaseReader.h"
+#include "AnalysisTools/TreeReader/interface/EventArena.h"
 #include "AnalysisTools/DataFormats/interface/PFCandidate.h"
 #include "AnalysisTools/TreeReader/interface/Defaults.h"
 
 namespace ucsbsusy {
 
+  // Collection of the reader, rebuilt in the event arena each event
+  typedef ArenaVector<PFCandidateF> PFCandidateFArenaCollection;
+
   class PFCandidateReader : public BaseReader {
 
     public :
@@ -35,6 +39,7 @@ namespace ucsbsusy {
 
     void load(TreeReader *treeReader, int options, std::string branchName);
     void refresh();
+    void releaseArena();
 
     public :
       std::vector<float> * pt;
@@ -62,7 +67,7 @@ namespace ucsbsusy {
       std::vector<float> * neartrkdr;
       std::vector<float> * trackiso;
 
-      PFCandidateFCollection pfcands;
+      PFCandidateFArenaCollection pfcands;
       ExtendedPFCandidateCollection extpfcands;
 
   };
@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------------------------------
+//
+// StageTimer
+//
+// Low overhead wall clock timing of the stages of an event loop (reading, object building,
+// analysis...) plus the event and byte throughput, sampled every reportInterval events.
+// The summary is printed as text and can be written to a ROOT file (histograms) or a JSON file.
+//
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISTOOLS_TREEREADER_STAGETIMER_H
+#define ANALYSISTOOLS_TREEREADER_STAGETIMER_H
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <TString.h>
+
+namespace ucsbsusy {
+
+  class StageTimer {
+  public :
+    typedef std::chrono::steady_clock Clock;
+
+    explicit StageTimer(int reportInterval = 1000);
+    ~StageTimer() {}
+
+    // Returns the index of the stage, existing stages are reused
+    int  addStage(const std::string& name);
+    void add(int stage, double seconds) { stages[stage].time += seconds; stages[stage].nCalls++; }
+
+    // Times its own lifetime, does nothing without a timer
+    class Scope {
+    public :
+      Scope(StageTimer * timer, int stage) : timer_(timer), stage_(stage) { if(timer_) start_ = Clock::now(); }
+      ~Scope() { if(timer_) timer_->add(stage_,std::chrono::duration<double>(Clock::now() - start_).count()); }
+    private:
+      StageTimer *      timer_;
+      int               stage_;
+      Clock::time_point start_;
+    };
+
+    // Count an event, totalBytes is the number of bytes read so far
+    void countEvent(Long64_t totalBytes);
+
+    void print(std::ostream& os = std::clog) const;
+    // Writes a JSON summary if the file name ends with .json, ROOT histograms otherwise
+    void write(const TString& fileName) const;
+
+  private:
+    struct Stage {
+      std::string name;
+      double      time;
+      Long64_t    nCalls;
+      Stage(const std::string& n) : name(n), time(0), nCalls(0) {}
+    };
+    double wallTime() const;
+    void   writeJSON(const TString& fileName) const;
+    void   writeROOT(const TString& fileName) const;
+
+    const int           reportInterval;
+    std::vector<Stage>  stages;
+    Long64_t            nEvents;
+    Long64_t            bytes;
+    bool                started;
+    Clock::time_point   start;
+    Clock::time_point   lastSample;
+    Long64_t            lastSampleBytes;
+    std::vector<double> eventRates; //events/s in each reportInterval
+    std::vector<double> byteRates;  //MB/s in each reportInterval
+  };
+
+}
+
+#endif
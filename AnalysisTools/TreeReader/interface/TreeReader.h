@@ -9,9 +9,14 @@
 #ifndef ANALYSISTOOLS_TREEREADER_TREEREADER_H
 #define ANALYSISTOOLS_TREEREADER_TREEREADER_H
 #include <TTree.h>
+#include <TChain.h>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
-
+#include "AnalysisTools/TreeReader/interface/EventArena.h"
+#include "AnalysisTools/TreeReader/interface/StageTimer.h"
+#include "AnalysisTools/Utilities/interface/TreeMetadata.h"
 
 
 namespace ucsbsusy {
@@ -20,6 +25,8 @@ namespace ucsbsusy {
 
   class TreeReader {
   public :
+      //fileName can be a single file or a list of files that are read as a TChain: comma separated
+      //names, wildcards (e.g. "dir/ttbar_*.root") or text files with one name per line ending in .txt or .list
       TreeReader(TString fileName, TString treeName, TString readOption = "READ");
       ~TreeReader();
 
@@ -57,22 +64,138 @@ namespace ucsbsusy {
         else return it->second;
       }
 
+      //Only enable the branches of the loaded readers again, e.g. after all were enabled to clone the tree
+      void restoreBranchStatus();
+
       //load a new reader
       void load(BaseReader * reader, int options, std::string branchName);
 
       //Load the next event from the tree....return false if there are no more events in the tree
       bool nextEvent(int reportFrequency = 1000000);
 
-      TTree * getTree() {return tree;}
+      //Restrict the event loop to the entries [firstEntry, lastEntry)...lastEntry < 0 means the end of the tree
+      void setEntryRange(int firstEntry, int lastEntry = -1);
+      int  getFirstEntry() const {return firstEntry;}
+      int  getLastEntry()  const {return lastEntry;}
+
+      //Only read the entries passing selection, a TTree::Draw expression on the branches of the tree
+      //(e.g. "met_pt > 200 && Length$(ak4pfchs_jet_pt) >= 4"). The list of passing entries is cached in
+      //cacheDir, keyed by the file fingerprint and the selection, so it is only built in the first job
+      //that uses them. An empty selection removes the preselection.
+      void setPreselection(TString selection, TString cacheDir = ".preselection");
+      Long64_t getNPreselected() const {return selectedEntries.size();}
+      bool     isPreselected()   const {return hasPreselection;}
+
+      //Pipelined reading: the baskets of the enabled branches are read ahead cluster by cluster into a
+      //TTreeCache and unzipped by a background thread while the current event is processed.
+      //prefetchDepth is the number of clusters the cache holds. Set up on the first call to nextEvent,
+      //so it can be called before or after the readers are loaded.
+      void setPrefetch(int prefetchDepth = 2);
+      //Per-branch bytes and read latency...switched on by setPrefetch, printed when the reader is deleted
+      void setBranchStatistics(bool collect = true) {collectStats = collect;}
+      void printBranchStatistics(std::ostream& os = std::clog) const;
+
+      //Branch usage profiling: branch statistics plus a record of which registered variables the analysis
+      //accessed through access(), summed per reader. Has to be set before the first event is read.
+      struct ReaderProfile {
+        int      nBranches;
+        int      nAccessed; //branches accessed at least once
+        Long64_t bytes;
+        double   readTime;
+        ReaderProfile() : nBranches(0), nAccessed(0), bytes(0), readTime(0) {}
+      };
+      void setProfiling(bool profile = true);
+      bool isProfiling() const {return profiling;}
+      ReaderProfile getReaderProfile(const BaseReader * reader) const;
+
+      //Lazy reading: nextEvent only moves to the next entry. A branch is read the first time it is
+      //accessed in the event (access()), the rest of the branches are read by loadEvent(), which also
+      //refreshes the readers. Has to be set before the first event is read.
+      void setLazyLoading(bool lazyLoading = true);
+      bool isLazy() const {return lazy;}
+      //Get var, reading its branch first if needed...var is the address that was given to setBranchAddress
+      //Throws when lazy and var is not the address of a loaded branch
+      template<typename varType>
+      varType& access(varType * var) {readBranch(var); return *var;}
+      void readBranch(const void * var);
+      //Read all remaining branches of the event and refresh the readers (does nothing if not lazy)
+      void loadEvent();
+
+      //Time the reading of the entries and the refresh() of each reader, the analysis code can add
+      //its own stages to the timer. Has to be set before the first event is read.
+      void setTiming(bool timing = true, int reportInterval = 1000);
+      StageTimer * getTimer() {return timer.get();} //0 if not timing
+      Long64_t getBytesRead() const {return bytesRead;} //uncompressed
+
+      //Scratch memory for the current event, freed when the next event is read
+      //Holds the reader object collections, the jet selection vetoes and the CORRAL candidates
+      EventArena& getArena() {return arena;}
+
+      static bool                 isFileList(const TString& fileName);
+      static std::vector<TString> getFileList(const TString& fileName, const TString& treeName);
+      const std::vector<TString>& getFileNames() const {return fileNames;}
+      //Metadata written with the input tree (see TreeMetadata), summed over the files of a chain
+      //Read from the tree headers on the first call, not valid if the input has none
+      const TreeMetadata& getMetadata();
+
+      TTree * getTree() {return tree;} //the TChain when reading several files
       int getEntries()  const {return tree->GetEntries();}
 
       int     eventNumber; //current event number
 
   private:
+      struct BranchInfo {
+        TBranch*    branch;
+        std::string name;
+        Long64_t    bytes;    //uncompressed bytes returned by GetEntry
+        double      readTime; //seconds spent in GetEntry (waiting for reading and unzipping)
+        Long64_t    nReads;
+        Long64_t    lastEntry; //last entry that was read
+        Long64_t    nAccessed; //events in which it was accessed through access()
+        Long64_t    lastAccess;
+        BranchInfo(TBranch* b) : branch(b), name(b->GetName()), bytes(0), readTime(0), nReads(0), lastEntry(-1), nAccessed(0), lastAccess(-1) {}
+      };
+
+      void setupBranches();
+      void setupPrefetch();
+      void readEntry(Long64_t entry);
+      void readBranch(BranchInfo& info);
+      void refreshReaders();
+      TString getFingerprint() const;
+      bool loadPreselection(const TString& cacheFile, const TString& fingerprint, const TString& selection);
+      void buildPreselection(const TString& cacheFile, const TString& fingerprint, const TString& selection);
+
       TFile * file;
       TTree * tree;
+      TChain* chain;      //only when reading a list of files, then tree == chain
+      int     treeNumber; //current tree of the chain
+      std::vector<TString> fileNames;
+      TreeMetadata         metadata;
+      bool                 metadataRead;
       std::vector<BaseReader*> readers; //List of loaded readers
+      std::vector<std::vector<std::string> > readerBranches; //branches registered by each of the readers
       std::map<const void *,std::string> branchList;
+      int     firstEntry;
+      int     lastEntry;
+      int     prefetchDepth;
+      bool    collectStats;
+      bool    isSetup;
+      bool    lazy;
+      bool    profiling;
+      bool    eventLoaded;  //all branches read and readers refreshed for the current entry
+      Long64_t currentEntry;
+      Long64_t localEntry;  //currentEntry in the current tree
+      Long64_t nEventsRead;
+      std::vector<BranchInfo> activeBranches; //enabled top level branches, only filled when collecting statistics or lazy
+      std::map<const void *,int> branchIndex; //address given to setBranchAddress -> index in activeBranches
+      bool    hasPreselection;
+      std::vector<Long64_t> selectedEntries; //sorted entries passing the preselection
+      size_t  nextSelected;
+      EventArena arena;
+      Long64_t bytesRead;
+      std::unique_ptr<StageTimer> timer;
+      int     readStage;
+      std::vector<int> refreshStages; //per reader
 
   };
 
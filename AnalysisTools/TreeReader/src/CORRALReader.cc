@@ -67,9 +67,10 @@ void CORRALReader::getCORRALData(const GenParticleReader * genParticleReader, Je
 
 
   //we now need to associate our reco jets with the jet ind
-  vector<int> trnBjetind (nTops);
-  vector<int> trnWjet1ind(nTops);
-  vector<int> trnWjet2ind(nTops);
+  const ArenaAllocator<int> alloc(eventArena());
+  ArenaVector<int> trnBjetind (nTops,0,alloc);
+  ArenaVector<int> trnWjet1ind(nTops,0,alloc);
+  ArenaVector<int> trnWjet2ind(nTops,0,alloc);
 
   for(unsigned int iT = 0; iT < nTops; ++iT){
     trnBjetind[iT]  = transformIndex(bjetind->at(iT) , corral->recoJets, true);
@@ -125,3 +125,8 @@ void ElectronReader::refresh(){
   }
 }
 
+//--------------------------------------------------------------------------------------------------
+void ElectronReader::releaseArena(){
+  ElectronFArenaCollection(ArenaAllocator<ElectronF>(eventArena())).swap(electrons);
+}
+
@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------------------
+//
+// EventArena
+//
+// Monotonic buffer for per-event scratch memory.
+//
+//--------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cstdint>
+#include <TString.h>
+#include "AnalysisTools/TreeReader/interface/EventArena.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+//--------------------------------------------------------------------------------------------------
+EventArena::EventArena(size_t minBlockSize) : blockSize(minBlockSize), offset(0), capacity(0), eventBytes(0), lastEventBytes(0),
+    totalRecycled(0), nResets(0)
+{}
+//--------------------------------------------------------------------------------------------------
+void EventArena::addBlock(size_t minSize)
+{
+  blocks.emplace_back(std::max(blockSize,minSize));
+  capacity += blocks.back().size;
+  offset    = 0;
+}
+//--------------------------------------------------------------------------------------------------
+void * EventArena::allocate(size_t bytes, size_t alignment)
+{
+  if(bytes == 0) bytes = 1;
+  size_t start = blocks.empty() ? 0 : alignedOffset(alignment);
+  if(blocks.empty() || start + bytes > blocks.back().size){
+    addBlock(bytes + alignment);
+    start = alignedOffset(alignment);
+  }
+  offset      = start + bytes;
+  eventBytes += bytes;
+  return blocks.back().data.get() + start;
+}
+//--------------------------------------------------------------------------------------------------
+size_t EventArena::alignedOffset(size_t alignment) const
+{
+  const uintptr_t base = reinterpret_cast<uintptr_t>(blocks.back().data.get());
+  return (base + offset + alignment - 1) / alignment * alignment - base;
+}
+//--------------------------------------------------------------------------------------------------
+void EventArena::reset()
+{
+  if(blocks.size() > 1){
+    const size_t total = capacity;
+    blocks.clear();
+    capacity = 0;
+    addBlock(total);
+  }
+  offset          = 0;
+  lastEventBytes  = eventBytes;
+  totalRecycled  += eventBytes;
+  eventBytes      = 0;
+  nResets++;
+}
+//--------------------------------------------------------------------------------------------------
+void EventArena::print(std::ostream& os) const
+{
+  os << TString::Format("Event arena: %.0f bytes recycled per event (%zu events), %zu kB capacity",
+                        getMeanRecycled(),nResets,capacity/1024) << endl;
+}
@@ -14,7 +14,7 @@
 using namespace std;
 using namespace ucsbsusy;
 
-EventInfoReader::EventInfoReader()
+EventInfoReader::EventInfoReader() : EventHeader()
 {
 
   run = 0;
@@ -42,6 +42,8 @@ void EventInfoReader::load(TreeReader *treeReader, int options, string branchNam
   clog << "Loading (" << branchName << ") event info with: ";
 
   loaded_ = true;
+  const_cast<int&>(options_)    = options;
+  const_cast<string&>(branchName_) = branchName;
   treeReader->setBranchAddress(branchName,"run", &run);
   treeReader->setBranchAddress(branchName,"lumi", &lumi);
   treeReader->setBranchAddress(branchName,"event", &event);
@@ -58,6 +60,8 @@ void EventInfoReader::load(TreeReader *treeReader, int options, string branchNam
   treeReader->setBranchAddress(branchName,"goodvertex", &goodvertex);
   treeReader->setBranchAddress(branchName,"process", &proc);
   treeReader->setBranchAddress(branchName,"wgtXSec", &weight);
+  if(options_ & HEADERONLY)
+    clog << " +HeaderOnly";
   clog << endl;
 }
 
@@ -120,11 +120,16 @@ void JetReader::load(TreeReader *treeReader, int options, string branchName)
   }
   if(options_ & FILLOBJ)
     clog << "+Objects";
+  if(options_ & FILLCOLUMNS){
+    if(!(options_ & LOADRECO)) throw std::invalid_argument("JetReader::load(): FILLCOLUMNS needs LOADRECO!");
+    clog << "+Columns";
+  }
   clog << endl;
 }
 
 //--------------------------------------------------------------------------------------------------
 void JetReader::refresh(){
+  if(options_ & FILLCOLUMNS) fillColumns();
   if(!(options_ & FILLOBJ)) return;
 
   if(options_ & LOADGEN){
@@ -150,6 +155,29 @@ void JetReader::refresh(){
 
 }
 
+//--------------------------------------------------------------------------------------------------
+void JetReader::releaseArena(){
+  RecoJetFArenaCollection(ArenaAllocator<RecoJetF>(eventArena())).swap(recoJets);
+  GenJetFArenaCollection (ArenaAllocator<GenJetF> (eventArena())).swap(genJets);
+}
+
+//--------------------------------------------------------------------------------------------------
+void JetReader::fillColumns(){
+  columns.size    = jetpt_->size();
+  columns.pt      = jetpt_  ->data();
+  columns.eta     = jeteta_ ->data();
+  columns.phi     = jetphi_ ->data();
+  columns.mass    = jetmass_->data();
+  columns.csv     = jetcsv_ ->data();
+  columns.looseId = jetlooseId_;
+
+  //sort a permutation rather than the jets themselves
+  columns.ptOrder.resize(columns.size);
+  for(unsigned int iJ = 0; iJ < columns.size; ++iJ) columns.ptOrder[iJ] = iJ;
+  const float * pt = columns.pt;
+  std::sort(columns.ptOrder.begin(),columns.ptOrder.end(),[pt](size16 a, size16 b){ return pt[a] > pt[b]; });
+}
+
 //--------------------------------------------------------------------------------------------------
 void JetReader::pushToTree(){
   if(options_ & LOADGEN)
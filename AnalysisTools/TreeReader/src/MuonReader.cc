@@ -114,3 +114,8 @@ void MuonReader::refresh(){
     }
   }
 }
+
+//--------------------------------------------------------------------------------------------------
+void MuonReader::releaseArena(){
+  MuonFArenaCollection(ArenaAllocator<MuonF>(eventArena())).swap(muons);
+}
@@ -153,3 +153,8 @@ void PFCandidateReader::refresh(){
   }
 }
 
+//--------------------------------------------------------------------------------------------------
+void PFCandidateReader::releaseArena(){
+  PFCandidateFArenaCollection(ArenaAllocator<PFCandidateF>(eventArena())).swap(pfcands);
+}
+
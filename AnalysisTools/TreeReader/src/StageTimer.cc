@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------------------
+//
+// StageTimer
+//
+// Wall clock timing of the stages of an event loop.
+//
+//--------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <TFile.h>
+#include <TH1D.h>
+#include <TParameter.h>
+#include "AnalysisTools/TreeReader/interface/StageTimer.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+//--------------------------------------------------------------------------------------------------
+StageTimer::StageTimer(int reportInterval) : reportInterval(std::max(1,reportInterval)), nEvents(0), bytes(0), started(false),
+    lastSampleBytes(0)
+{}
+//--------------------------------------------------------------------------------------------------
+int StageTimer::addStage(const std::string& name)
+{
+  for(unsigned int iS = 0; iS < stages.size(); ++iS)
+    if(stages[iS].name == name) return iS;
+  stages.emplace_back(name);
+  return stages.size() - 1;
+}
+//--------------------------------------------------------------------------------------------------
+void StageTimer::countEvent(Long64_t totalBytes)
+{
+  const Clock::time_point now = Clock::now();
+  if(!started){
+    started    = true;
+    start      = now;
+    lastSample = now;
+  }
+  nEvents++;
+  bytes = totalBytes;
+  if(nEvents % reportInterval) return;
+
+  const double dt = std::chrono::duration<double>(now - lastSample).count();
+  if(dt > 0){
+    eventRates.push_back(reportInterval/dt);
+    byteRates .push_back((totalBytes - lastSampleBytes)/1.e6/dt);
+  }
+  lastSample      = now;
+  lastSampleBytes = totalBytes;
+}
+//--------------------------------------------------------------------------------------------------
+double StageTimer::wallTime() const
+{
+  return started ? std::chrono::duration<double>(Clock::now() - start).count() : 0;
+}
+//--------------------------------------------------------------------------------------------------
+void StageTimer::print(std::ostream& os) const
+{
+  const double wall = wallTime();
+  double staged = 0;
+  for(const auto& stage : stages) staged += stage.time;
+
+  os << TString::Format("Event loop timing: %lld events in %.1f s (%.1f events/s, %.2f MB/s read)",nEvents,wall,
+                        wall > 0 ? nEvents/wall : 0., wall > 0 ? bytes/1.e6/wall : 0.) << endl;
+  os << TString::Format("%-30s %12s %8s %12s","stage","s","%","us/event") << endl;
+  for(const auto& stage : stages)
+    os << TString::Format("%-30s %12.2f %8.1f %12.2f",stage.name.c_str(),stage.time,wall > 0 ? 100*stage.time/wall : 0.,
+                          nEvents ? 1.e6*stage.time/nEvents : 0.) << endl;
+  os << TString::Format("%-30s %12.2f %8.1f %12.2f","other",std::max(0.,wall - staged),wall > 0 ? 100*std::max(0.,wall - staged)/wall : 0.,
+                        nEvents ? 1.e6*std::max(0.,wall - staged)/nEvents : 0.) << endl;
+}
+//--------------------------------------------------------------------------------------------------
+void StageTimer::write(const TString& fileName) const
+{
+  if(fileName.EndsWith(".json")) writeJSON(fileName);
+  else                           writeROOT(fileName);
+}
+//--------------------------------------------------------------------------------------------------
+void StageTimer::writeJSON(const TString& fileName) const
+{
+  ofstream out(fileName.Data());
+  if(!out) throw std::invalid_argument((TString("StageTimer::write: could not open ") + fileName).Data());
+
+  out << "{\n";
+  out << "  \"events\": " << nEvents << ",\n";
+  out << "  \"wallTime\": " << wallTime() << ",\n";
+  out << "  \"bytesRead\": " << bytes << ",\n";
+  out << "  \"stages\": {";
+  for(unsigned int iS = 0; iS < stages.size(); ++iS)
+    out << (iS ? "," : "") << "\n    \"" << stages[iS].name << "\": {\"time\": " << stages[iS].time << ", \"calls\": " << stages[iS].nCalls << "}";
+  out << "\n  },\n";
+  out << "  \"eventsPerSecond\": [";
+  for(unsigned int iR = 0; iR < eventRates.size(); ++iR) out << (iR ? ", " : "") << eventRates[iR];
+  out << "],\n";
+  out << "  \"MBPerSecond\": [";
+  for(unsigned int iR = 0; iR < byteRates.size(); ++iR) out << (iR ? ", " : "") << byteRates[iR];
+  out << "]\n";
+  out << "}\n";
+}
+//--------------------------------------------------------------------------------------------------
+void StageTimer::writeROOT(const TString& fileName) const
+{
+  TDirectory * dir = gDirectory;
+  TFile * file = TFile::Open(fileName,"RECREATE");
+  if(!file) throw std::invalid_argument((TString("StageTimer::write: could not open ") + fileName).Data());
+  file->cd();
+
+  //the histograms live on the stack, so keep them out of the file's list of objects
+  TH1D stageTimes("stageTimes",";;time [s]",stages.size() + 1,0,stages.size() + 1);
+  stageTimes.SetDirectory(0);
+  double staged = 0;
+  for(unsigned int iS = 0; iS < stages.size(); ++iS){
+    stageTimes.GetXaxis()->SetBinLabel(iS + 1,stages[iS].name.c_str());
+    stageTimes.SetBinContent(iS + 1,stages[iS].time);
+    staged += stages[iS].time;
+  }
+  stageTimes.GetXaxis()->SetBinLabel(stages.size() + 1,"other");
+  stageTimes.SetBinContent(stages.size() + 1,std::max(0.,wallTime() - staged));
+  stageTimes.Write();
+
+  const double maxEventRate = eventRates.empty() ? 1 : *std::max_element(eventRates.begin(),eventRates.end());
+  const double maxByteRate  = byteRates .empty() ? 1 : *std::max_element(byteRates .begin(),byteRates .end());
+  TH1D eventRate("eventRate",TString::Format(";events/s (per %i events);intervals",reportInterval),100,0,1.1*maxEventRate);
+  TH1D byteRate ("byteRate" ,TString::Format(";MB/s (per %i events);intervals"    ,reportInterval),100,0,1.1*maxByteRate);
+  eventRate.SetDirectory(0);
+  byteRate .SetDirectory(0);
+  for(double rate : eventRates) eventRate.Fill(rate);
+  for(double rate : byteRates ) byteRate .Fill(rate);
+  eventRate.Write();
+  byteRate .Write();
+
+  TParameter<Long64_t>("events"   ,nEvents   ).Write();
+  TParameter<double>  ("wallTime" ,wallTime()).Write();
+  TParameter<Long64_t>("bytesRead",bytes     ).Write();
+
+  file->Close();
+  delete file;
+  if(dir) dir->cd();
+}
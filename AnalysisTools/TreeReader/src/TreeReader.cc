@@ -7,22 +7,46 @@
 // 
 //--------------------------------------------------------------------------------------------------
 #include <TFile.h>
+#include <TChain.h>
+#include <TROOT.h>
+#include <TUUID.h>
+#include <TEntryList.h>
+#include <TObjString.h>
+#include <TSystem.h>
 #include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include "AnalysisTools/TreeReader/interface/TreeReader.h"
 #include "AnalysisTools/TreeReader/interface/BaseReader.h"
+#include "AnalysisTools/Utilities/interface/FileFingerprint.h"
 
 using namespace std;
 using namespace ucsbsusy;
 
 //--------------------------------------------------------------------------------------------------
-TreeReader::TreeReader(TString fileName, TString treeName, TString readOption) : eventNumber(0)
+TreeReader::TreeReader(TString fileName, TString treeName, TString readOption) : eventNumber(0), file(0), tree(0), chain(0), treeNumber(-1), metadataRead(false),
+    firstEntry(0), lastEntry(-1),
+    prefetchDepth(0), collectStats(false), isSetup(false), lazy(false), profiling(false), eventLoaded(false), currentEntry(-1), localEntry(-1),
+    nEventsRead(0), hasPreselection(false), nextSelected(0), bytesRead(0), readStage(-1)
 {
   std::clog << "Loading file: "<< fileName <<" and tree: " << treeName <<std::endl;
 
-  file = TFile::Open(fileName,readOption);
-  assert(file);
-  tree = (TTree*)(file->Get(treeName) );
-  assert(tree);
+  if(!isFileList(fileName)){
+    file = TFile::Open(fileName,readOption);
+    assert(file);
+    tree = (TTree*)(file->Get(treeName) );
+    assert(tree);
+    fileNames.push_back(fileName);
+  } else {
+    if(readOption != "READ") throw std::invalid_argument("TreeReader: a list of files can only be read");
+    chain     = new TChain(treeName);
+    tree      = chain;
+    fileNames = getFileList(fileName,treeName);
+    for(const auto& name : fileNames) chain->Add(name);
+    if(fileNames.empty()) throw std::invalid_argument((TString("TreeReader: no files found for ") + fileName).Data());
+    std::clog << "Chaining " << fileNames.size() << " files" << std::endl;
+  }
   tree->SetBranchStatus("*",0);
   std::clog << getEntries() << " entries to process" << std::endl;
 
@@ -30,27 +54,435 @@ TreeReader::TreeReader(TString fileName, TString treeName, TString readOption) :
 //--------------------------------------------------------------------------------------------------
 TreeReader::~TreeReader()
 {
+  if((collectStats || lazy) && isSetup) printBranchStatistics();
+  if(arena.getCapacity()) arena.print();
+  if(chain){
+    delete chain;
+    return;
+  }
   file->Close();
   delete file;
 }
+//--------------------------------------------------------------------------------------------------
+bool TreeReader::isFileList(const TString& fileName)
+{
+  return fileName.Contains(",") || fileName.Contains("*") || fileName.Contains("?") || fileName.EndsWith(".txt") || fileName.EndsWith(".list");
+}
+//--------------------------------------------------------------------------------------------------
+std::vector<TString> TreeReader::getFileList(const TString& fileName, const TString& treeName)
+{
+  //expand everything into single files
+  vector<TString> patterns;
+  TObjArray * tokens = fileName.Tokenize(",");
+  for(int iT = 0; iT < tokens->GetEntriesFast(); ++iT){
+    TString token = ((TObjString*)tokens->At(iT))->GetString().Strip(TString::kBoth);
+    if(token == "") continue;
+    if(token.EndsWith(".txt") || token.EndsWith(".list")){
+      ifstream list(token.Data());
+      if(!list) throw std::invalid_argument((TString("TreeReader: could not open file list ") + token).Data());
+      string line;
+      while(getline(list,line)){
+        TString name = TString(line).Strip(TString::kBoth);
+        if(name != "" && !name.BeginsWith("#")) patterns.push_back(name);
+      }
+    } else
+      patterns.push_back(token);
+  }
+  delete tokens;
+
+  //TChain does the globbing
+  TChain chain(treeName);
+  for(const auto& pattern : patterns) chain.Add(pattern);
+  vector<TString> files;
+  TIter next(chain.GetListOfFiles());
+  while(TObject * element = next()) files.push_back(element->GetTitle());
+  return files;
+}
+//--------------------------------------------------------------------------------------------------
+const TreeMetadata& TreeReader::getMetadata()
+{
+  if(metadataRead) return metadata;
+  metadataRead = true;
+  if(!chain){
+    metadata.read(tree);
+    return metadata;
+  }
+  //only the tree headers are read, the metadata of files without it is left out
+  for(const auto& name : fileNames){
+    TFile * input = TFile::Open(name,"READ");
+    TTree * inputTree = input ? (TTree*)(input->Get(chain->GetName())) : 0;
+    TreeMetadata fileMetadata;
+    if(inputTree && fileMetadata.read(inputTree)) metadata.add(fileMetadata);
+    else std::clog << "TreeReader: no metadata in " << name << std::endl;
+    delete input;
+  }
+  return metadata;
+}
+
 //--------------------------------------------------------------------------------------------------
 void TreeReader::load(BaseReader * reader, int options, std::string branchName)
 {
+  reader->treeReader_ = this;
+  const std::map<const void *,std::string> oldBranches = branchList;
   reader->load(this,options,branchName);
   readers.push_back(reader);
+
+  readerBranches.emplace_back();
+  for(const auto& var : branchList)
+    if(!oldBranches.count(var.first)) readerBranches.back().push_back(var.second);
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setEntryRange(int first, int last)
+{
+  if(first < 0 || (last >= 0 && last < first))
+    throw std::invalid_argument(TString::Format("TreeReader::setEntryRange: invalid range [%i,%i)",first,last).Data());
+  firstEntry  = first;
+  lastEntry   = last;
+  eventNumber = first;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setPrefetch(int depth)
+{
+  if(isSetup) throw std::invalid_argument("TreeReader::setPrefetch: has to be called before the first event is read");
+  prefetchDepth = depth;
+  if(prefetchDepth > 0) collectStats = true;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setLazyLoading(bool lazyLoading)
+{
+  if(isSetup) throw std::invalid_argument("TreeReader::setLazyLoading: has to be called before the first event is read");
+  lazy = lazyLoading;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setPreselection(TString selection, TString cacheDir)
+{
+  if(isSetup) throw std::invalid_argument("TreeReader::setPreselection: has to be called before the first event is read");
+  selectedEntries.clear();
+  nextSelected    = 0;
+  hasPreselection = selection != "";
+  if(!hasPreselection) return;
+
+  const TString fingerprint = getFingerprint();
+  const TString cacheFile   = cacheDir + "/" + FileFingerprint::hash(fingerprint + "\n" + selection) + ".root";
+  if(loadPreselection(cacheFile,fingerprint,selection))
+    clog << "Loaded preselection from " << cacheFile;
+  else {
+    buildPreselection(cacheFile,fingerprint,selection);
+    clog << "Built preselection in " << cacheFile;
+  }
+  clog << ": " << selectedEntries.size() << " of " << getEntries() << " entries pass \"" << selection << "\"" << endl;
+}
+//--------------------------------------------------------------------------------------------------
+bool TreeReader::loadPreselection(const TString& cacheFile, const TString& fingerprint, const TString& selection)
+{
+  if(gSystem->AccessPathName(cacheFile)) return false;
+  TFile * cache = TFile::Open(cacheFile,"READ");
+  if(!cache) return false;
+
+  //protect against hash collisions and half written files
+  TObjString * cachedPrint = (TObjString*)(cache->Get("fingerprint"));
+  TObjString * cachedSel   = (TObjString*)(cache->Get("selection"));
+  TEntryList * list        = (TEntryList*)(cache->Get("preselection"));
+  const bool valid = cachedPrint && cachedSel && list && cachedPrint->GetString() == fingerprint && cachedSel->GetString() == selection;
+  if(valid){
+    selectedEntries.reserve(list->GetN());
+    for(Long64_t iE = 0; iE < list->GetN(); ++iE)
+      selectedEntries.push_back(list->GetEntry(iE));
+  }
+  cache->Close();
+  delete cache;
+  return valid;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::buildPreselection(const TString& cacheFile, const TString& fingerprint, const TString& selection)
+{
+  //use a separate chain of the input, since the branches of this one are disabled
+  TDirectory * dir = gDirectory;
+  gROOT->cd();
+  TChain input(tree->GetName());
+  for(const auto& name : fileNames) input.Add(name);
+  const Long64_t nEntries = input.GetEntries();
+  if(input.Draw(">>preselection",selection,"entrylist") < 0)
+    throw std::invalid_argument((TString("TreeReader::setPreselection: invalid selection: ") + selection).Data());
+  TEntryList * list = (TEntryList*)(gDirectory->Get("preselection"));
+  assert(list);
+
+  //the chain list holds one sub-list per file, store the global entry numbers instead
+  TEntryList entries("preselection",selection);
+  entries.SetDirectory(0);
+  selectedEntries.reserve(list->GetN());
+  for(Long64_t iE = 0; iE < list->GetN(); ++iE){
+    Int_t treeNum = 0;
+    const Long64_t entry = list->GetLists() ? list->GetEntryAndTree(iE,treeNum) + input.GetTreeOffset()[treeNum] : list->GetEntry(iE);
+    selectedEntries.push_back(entry);
+    entries.Enter(entry);
+  }
+  std::sort(selectedEntries.begin(),selectedEntries.end());
+  delete list;
+  assert(selectedEntries.empty() || selectedEntries.back() < nEntries);
+
+  //write to a temporary file and rename it, so that parallel jobs never see a partial cache
+  gSystem->mkdir(gSystem->DirName(cacheFile),true);
+  const TString tmpFile = cacheFile + "." + TUUID().AsString() + ".tmp";
+  TFile * cache = TFile::Open(tmpFile,"RECREATE");
+  if(cache){
+    cache->cd();
+    entries.Write("preselection");
+    TObjString(fingerprint).Write("fingerprint");
+    TObjString(selection).Write("selection");
+    cache->Close();
+    delete cache;
+    gSystem->Rename(tmpFile,cacheFile);
+  } else
+    clog << "TreeReader::setPreselection: could not write the preselection cache " << cacheFile << endl;
+
+  dir->cd();
+}
+//--------------------------------------------------------------------------------------------------
+TString TreeReader::getFingerprint() const
+{
+  if(!chain) return FileFingerprint::get(tree);
+  TString fingerprint = TString::Format("%s:%lld",tree->GetName(),tree->GetEntries());
+  for(const auto& name : fileNames) fingerprint += "|" + FileFingerprint::get(name);
+  return fingerprint;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setTiming(bool timing, int reportInterval)
+{
+  if(isSetup) throw std::invalid_argument("TreeReader::setTiming: has to be called before the first event is read");
+  if(timing) timer.reset(new StageTimer(reportInterval));
+  else       timer.reset();
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setProfiling(bool profile)
+{
+  if(isSetup) throw std::invalid_argument("TreeReader::setProfiling: has to be called before the first event is read");
+  profiling = profile;
+  if(profiling) collectStats = true;
+}
+//--------------------------------------------------------------------------------------------------
+TreeReader::ReaderProfile TreeReader::getReaderProfile(const BaseReader * reader) const
+{
+  ReaderProfile profile;
+  for(unsigned int iR = 0; iR < readers.size(); ++iR){
+    if(readers[iR] != reader) continue;
+    for(const auto& name : readerBranches[iR]){
+      profile.nBranches++;
+      for(const auto& info : activeBranches){
+        if(info.name != name) continue;
+        if(info.nAccessed) profile.nAccessed++;
+        profile.bytes    += info.bytes;
+        profile.readTime += info.readTime;
+      }
+    }
+  }
+  return profile;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::restoreBranchStatus()
+{
+  assert(!isSetup);
+  tree->SetBranchStatus("*",0);
+  for(const auto& branch : branchList)
+    tree->SetBranchStatus(branch.second.c_str(),1);
+}
+
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setupBranches()
+{
+  //same branches that TTree::GetEntry would read
+  //(a chain only has branches once its first tree is loaded)
+  tree->LoadTree(eventNumber);
+  treeNumber = tree->GetTreeNumber();
+  activeBranches.clear();
+  TObjArray * branches = tree->GetListOfBranches();
+  for(int iB = 0; iB < branches->GetEntriesFast(); ++iB){
+    TBranch * branch = (TBranch*)branches->UncheckedAt(iB);
+    if(branch->TestBit(kDoNotProcess)) continue;
+    activeBranches.emplace_back(branch);
+  }
+
+  branchIndex.clear();
+  for(const auto& var : branchList)
+    for(unsigned int iB = 0; iB < activeBranches.size(); ++iB)
+      if(activeBranches[iB].name == var.second) branchIndex[var.first] = iB;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::setupPrefetch()
+{
+  //size the cache to hold prefetchDepth clusters of the enabled branches
+  Long64_t zipBytes = 0;
+  for(const auto& info : activeBranches) zipBytes += info.branch->GetZipBytes("*");
+  TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+  clusters();
+  const Long64_t nEntries    = std::max(Long64_t(1),tree->GetEntries());
+  const Long64_t clusterSize = std::max(Long64_t(1),clusters.GetNextEntry());
+  const Long64_t cacheSize   = std::max(Long64_t(1) << 20, prefetchDepth * zipBytes * clusterSize / nEntries);
+
+  //has to be set before the cache is created
+  //(TFile.AsyncPrefetching is not used: it is process wide and only read when a file is opened)
+  tree->SetParallelUnzip(kTRUE);
+
+  tree->SetCacheSize(cacheSize);
+  for(const auto& info : activeBranches) tree->AddBranchToCache(info.name.c_str(),kTRUE);
+  tree->StopCacheLearningPhase();
+
+  clog << "Prefetching " << activeBranches.size() << " branches with a " << cacheSize/1024 << " kB cache ("
+       << prefetchDepth << " clusters of " << clusterSize << " entries)" << endl;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::readEntry(Long64_t entry)
+{
+  StageTimer::Scope stageTime(timer.get(),readStage);
+  currentEntry = entry;
+  nEventsRead++;
+  if(!collectStats && !lazy){
+    const Int_t nBytes = tree->GetEntry(entry);
+    if(nBytes > 0) bytesRead += nBytes;
+    return;
+  }
+
+  localEntry = tree->LoadTree(entry);
+  if(tree->GetTreeNumber() != treeNumber){
+    //new file in the chain: the addresses are kept by the chain, but the branches are new objects
+    treeNumber = tree->GetTreeNumber();
+    for(auto& info : activeBranches)
+      info.branch = tree->GetTree()->GetBranch(info.name.c_str());
+  }
+  if(lazy) return;
+  for(auto& info : activeBranches)
+    readBranch(info);
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::readBranch(BranchInfo& info)
+{
+  if(info.lastEntry == currentEntry) return;
+  info.lastEntry = currentEntry;
+  info.nReads++;
+
+  Int_t nBytes = 0;
+  if(!collectStats)
+    nBytes = info.branch->GetEntry(localEntry);
+  else {
+    const auto start = chrono::steady_clock::now();
+    nBytes = info.branch->GetEntry(localEntry);
+    info.readTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  }
+  if(nBytes > 0){
+    info.bytes += nBytes;
+    bytesRead  += nBytes;
+  }
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::readBranch(const void * var)
+{
+  const bool read = lazy && !eventLoaded;
+  if(!read && !profiling) return;
+  std::map<const void *,int>::const_iterator it = branchIndex.find(var);
+  if(it == branchIndex.end()){
+    //lazily nothing else would fill it before loadEvent(), so the value would be stale
+    if(read) throw std::invalid_argument((TString("TreeReader::readBranch: address is not loaded from an enabled branch (") + getBranchName(var).c_str() + ")").Data());
+    return;
+  }
+  BranchInfo& info = activeBranches[it->second];
+  if(profiling && info.lastAccess != currentEntry){
+    info.lastAccess = currentEntry;
+    info.nAccessed++;
+  }
+  if(read) readBranch(info);
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::loadEvent()
+{
+  if(!lazy || eventLoaded) return;
+  {
+    StageTimer::Scope stageTime(timer.get(),readStage);
+    for(auto& info : activeBranches)
+      readBranch(info);
+  }
+  refreshReaders();
+  eventLoaded = true;
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::refreshReaders()
+{
+  if(!timer){
+    for(auto reader : readers)
+      reader->refresh();
+    return;
+  }
+  for(unsigned int iR = 0; iR < readers.size(); ++iR){
+    StageTimer::Scope stageTime(timer.get(),refreshStages[iR]);
+    readers[iR]->refresh();
+  }
+}
+//--------------------------------------------------------------------------------------------------
+void TreeReader::printBranchStatistics(std::ostream& os) const
+{
+  vector<const BranchInfo*> sorted;
+  Long64_t totBytes = 0;
+  double   totTime  = 0;
+  for(const auto& info : activeBranches){
+    sorted.push_back(&info);
+    totBytes += info.bytes;
+    totTime  += info.readTime;
+  }
+  std::sort(sorted.begin(),sorted.end(),[](const BranchInfo* a, const BranchInfo* b){return a->readTime > b->readTime;});
+
+  os << "Branch read statistics for " << tree->GetName() << " (" << sorted.size() << " branches, " << nEventsRead << " events"
+     << (lazy ? ", lazy" : "") << "):" << endl;
+  os << TString::Format("%-40s %10s %8s %12s %12s %12s %10s","branch","reads","% evts","MB","ms","us/read","accessed") << endl;
+  for(const auto* info : sorted)
+    os << TString::Format("%-40s %10lld %8.1f %12.2f %12.1f %12.2f %10s",info->name.c_str(),info->nReads,
+                          nEventsRead ? 100.*info->nReads/nEventsRead : 0.,info->bytes/1.e6,
+                          info->readTime*1.e3,info->nReads ? info->readTime*1.e6/info->nReads : 0.,
+                          profiling ? TString::Format("%lld",info->nAccessed).Data() : "-") << endl;
+  os << TString::Format("%-40s %10s %8s %12.2f %12.1f","total","","",totBytes/1.e6,totTime*1.e3) << endl;
 }
 //--------------------------------------------------------------------------------------------------
 bool TreeReader::nextEvent(int reportFrequency)
 {
-  if(eventNumber >= tree->GetEntries()) return false;
-  tree->GetEntry(eventNumber);
+  if(hasPreselection){
+    while(nextSelected < selectedEntries.size() && selectedEntries[nextSelected] < eventNumber) nextSelected++;
+    if(nextSelected == selectedEntries.size()) return false;
+    eventNumber = selectedEntries[nextSelected++];
+  }
+  if(eventNumber >= (lastEntry < 0 ? tree->GetEntries() : std::min(Long64_t(lastEntry),tree->GetEntries()))) return false;
+
+  if(!isSetup){
+    if(collectStats || prefetchDepth > 0 || lazy) setupBranches();
+    if(prefetchDepth > 0) setupPrefetch();
+    if(timer){
+      readStage = timer->addStage("GetEntry");
+      for(auto reader : readers)
+        refreshStages.push_back(timer->addStage("refresh " + (reader->branchName() == "" ? std::string("(no prefix)") : reader->branchName())));
+    }
+    isSetup = true;
+  }
+  for(auto reader : readers) reader->releaseArena();
+  arena.reset();
+  readEntry(eventNumber);
 
-  if(eventNumber%reportFrequency == 0)
+  if((hasPreselection ? nextSelected - 1 : eventNumber)%reportFrequency == 0)
     clog << "Processing event " << eventNumber << endl;
 
-  for(auto reader : readers)
-    reader->refresh();
+  eventLoaded = false;
+  if(!lazy){
+    refreshReaders();
+    eventLoaded = true;
+  }
+  if(timer) timer->countEvent(bytesRead);
 
   eventNumber++;
   return true;
 }
+//--------------------------------------------------------------------------------------------------
+void BaseReader::readBranch(const void * var) const
+{
+  if(treeReader_) treeReader_->readBranch(var);
+}
+//--------------------------------------------------------------------------------------------------
+EventArena * BaseReader::eventArena() const
+{
+  return treeReader_ ? &treeReader_->getArena() : 0;
+}
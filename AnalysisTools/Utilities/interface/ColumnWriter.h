@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// ColumnWriter
+// 
+// Writes flat data as a chunked binary column file, for training macros that want whole columns
+// instead of TTree entries. Values are appended per column in blocks (e.g. all jets of an event
+// at once) and written every chunkRows rows, one contiguous array per column.
+//
+// File layout, all numbers in native byte order:
+//   "UCSBCOL1", uint32 nColumns
+//   per column: uint32 name length, name, char ROOT leaf type code ("F","I","O",...), uint32 bytes per value
+//   per chunk:  uint64 nRows, then for each column nRows values
+//   uint64 0 at the end of the file
+// 
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISTOOLS_UTILITIES_COLUMNWRITER_H
+#define ANALYSISTOOLS_UTILITIES_COLUMNWRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <assert.h>
+#include <TString.h>
+
+namespace ucsbsusy {
+
+  class ColumnWriter {
+
+    public :
+      ColumnWriter(TString fileName, size_t chunkRows = 65536);
+      ~ColumnWriter();
+
+      // All columns have to be added before the first block
+      template<class T>
+      size_t		addColumn(const std::string& name, const std::string& type)	{
+        assert(!fHeaderWritten);
+        fColumns.push_back(Column(name, type.empty() ? '?' : type[0], sizeof(T)));
+        return fColumns.size() - 1;
+      }
+
+      // Append the same value n times
+      template<class T>
+      void		fill(size_t column, const T& value, size_t n)	{
+        T * out = (T*)grow(column, sizeof(T), n);
+        for(size_t i = 0; i < n; ++i) out[i] = value;
+      }
+      // Append a whole vector
+      template<class T>
+      void		fill(size_t column, const std::vector<T>& values)	{
+        if(values.empty()) return;
+        std::memcpy(grow(column, sizeof(T), values.size()), &values[0], sizeof(T)*values.size());
+      }
+      void		fill(size_t column, const std::vector<bool>& values);
+
+      // Ends a block of nRows rows, every column has to have been filled with exactly nRows values
+      void		endBlock(size_t nRows);
+      // Writes the last chunk and the end marker, also done by the destructor
+      void		close();
+
+      size_t		getNColumns()		  const { return fColumns.size();	}
+      size_t		getNRows()		  const { return fNRows;	}
+
+    protected :
+      struct Column {
+        Column(const std::string& n, char t, size_t s) : name(n), type(t), size(s) {}
+        std::string	name;
+        char		type;
+        size_t		size;
+        std::vector<char> data;
+      };
+
+      char		*grow(size_t column, size_t size, size_t n);
+      void		writeHeader();
+      void		writeChunk();
+
+      TString		fFileName;
+      size_t		fChunkRows;
+      size_t		fChunkFill;	// rows in the current chunk
+      size_t		fNRows;
+      bool		fHeaderWritten;
+      std::ofstream	fOut;
+      std::vector<Column> fColumns;
+
+  }; // ColumnWriter
+
+}
+
+#endif
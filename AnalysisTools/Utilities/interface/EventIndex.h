@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// EventIndex
+// 
+// Set of (run, lumi, event) triples with O(1) insertion and lookup, e.g. to reject the events that
+// appear in more than one data stream. Stored on disk as a small tree "eventIndex" with one entry
+// per run and lumi section holding the sorted event numbers.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISTOOLS_UTILITIES_EVENTINDEX_H
+#define ANALYSISTOOLS_UTILITIES_EVENTINDEX_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <TString.h>
+
+class TDirectory;
+
+namespace ucsbsusy {
+
+  class EventIndex {
+
+    public :
+      EventIndex() : fNEvents(0) {}
+
+      // Returns false if the event was already in the index
+      bool		insert(unsigned int run, unsigned int lumi, unsigned int event);
+      bool		contains(unsigned int run, unsigned int lumi, unsigned int event) const;
+      bool		containsLumi(unsigned int run, unsigned int lumi) const	{ return fLumis.count(key(run,lumi));	}
+      size_t		getNEvents()		  const { return fNEvents;	}
+      size_t		getNLumis()		  const { return fLumis.size();	}
+      void		clear()				{ fLumis.clear(); fNEvents = 0;	}
+
+      // Writes the "eventIndex" tree into dir
+      void		write(TDirectory *dir) const;
+      // Adds the events of the "eventIndex" tree in the file, returns false if it has none
+      bool		read(const TString& fileName);
+
+    protected :
+      static unsigned long long	key(unsigned int run, unsigned int lumi)	{ return (ULong64_t(run) << 32) | lumi;	}
+
+      std::unordered_map<unsigned long long, std::unordered_set<unsigned int> >	fLumis;
+      size_t		fNEvents;
+
+  }; // EventIndex
+
+}
+
+#endif
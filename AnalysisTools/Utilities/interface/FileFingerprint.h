@@ -0,0 +1,29 @@
+/*
+ * FileFingerprint.h
+ *
+ * Identify the content of ROOT files, e.g. to key caches of things derived from them.
+ * A file is identified by its UUID (new for every file ROOT creates), its size and the time it was
+ * last written, so a rewritten or updated file gets a new fingerprint while a copy keeps it.
+ */
+
+#ifndef FILEFINGERPRINT_H_
+#define FILEFINGERPRINT_H_
+
+#include <TString.h>
+
+class TFile;
+class TTree;
+
+namespace FileFingerprint {
+  //fingerprint of the file
+  TString get(const TFile* file);
+  //fingerprint of the file of the tree plus the tree name and number of entries
+  TString get(const TTree* tree);
+  //opens the file to get its fingerprint, throws if it cannot be opened
+  TString get(const TString& fileName);
+
+  //md5 of the string, e.g. to combine a fingerprint with other configuration into a cache key
+  TString hash(const TString& str);
+}
+
+#endif
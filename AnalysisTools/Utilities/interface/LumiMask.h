@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// LumiMask
+// 
+// Certified luminosity sections from a CMS JSON file ({"run": [[firstLumi, lastLumi], ...], ...}).
+// The ranges of each run are expanded into a bitmap when the file is read, so checking an event is
+// a hash lookup of the run and a bit test of the lumi section.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISTOOLS_UTILITIES_LUMIMASK_H
+#define ANALYSISTOOLS_UTILITIES_LUMIMASK_H
+
+#include <vector>
+#include <unordered_map>
+#include <TString.h>
+
+namespace ucsbsusy {
+
+  class LumiMask {
+
+    public :
+      // Throws if the file cannot be read or parsed
+      LumiMask(const TString& jsonFile);
+
+      bool		contains(unsigned int run, unsigned int lumi) const {
+        const auto it = fRuns.find(run);
+        return it != fRuns.end() && lumi < it->second.size() && it->second[lumi];
+      }
+      size_t		getNRuns()		  const { return fRuns.size();	}
+      size_t		getNLumis()		  const;
+
+    protected :
+      std::unordered_map<unsigned int, std::vector<bool> >	fRuns;
+
+  }; // LumiMask
+
+}
+
+#endif
@@ -76,9 +76,9 @@ ucsbsusy::size countObjectsDeref(const std::vector<ObjectPtr>& objects, double m
 template<typename ObjectPtr>
 ucsbsusy::size countObjectsDeref(const std::vector<ObjectPtr>& objects, double minPT, double maxEta);
 
-/// Count the number of objects, optionally passing a given test.
-template<typename Object>
-ucsbsusy::size countObjects(const std::vector<Object>& objects, double minPT = 0, double maxEta = 9999, bool (*test)(const Object&) = 0);
+/// Count the number of objects, optionally passing a given test (any allocator, e.g. the reader collections).
+template<typename Object, typename Allocator>
+ucsbsusy::size countObjects(const std::vector<Object,Allocator>& objects, double minPT = 0, double maxEta = 9999, bool (*test)(const Object&) = 0);
 
 /// Count the number of objects passing the given test.
 template<typename Object, typename Analyzer>
@@ -0,0 +1,56 @@
+/*
+ * RunParallel.h
+ *
+ * Minimal thread pool for independent jobs, e.g. one per file or chunk.
+ * runParallel(n, nThreads, work) calls work(i) for every i in [0, n), handing out the indices in order
+ * to up to nThreads threads. If a job throws, no further jobs are started and the first exception is
+ * rethrown in the calling thread once the running jobs are done.
+ * With nThreads <= 1 (or a single job) everything runs in the calling thread.
+ * Thread safety of ROOT (ROOT::EnableThreadSafety) is left to the caller.
+ */
+
+#ifndef RUNPARALLEL_H_
+#define RUNPARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ucsbsusy {
+
+  template<typename Work>
+  void runParallel(unsigned int n, int nThreads, Work work)
+  {
+    if(nThreads <= 1 || n < 2){
+      for(unsigned int i = 0; i < n; ++i) work(i);
+      return;
+    }
+
+    std::atomic<unsigned int> next(0);
+    std::exception_ptr        error;
+    std::mutex                errorLock;
+    auto loop = [&]() {
+      for(unsigned int i = next++; i < n; i = next++){
+        try {
+          work(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(errorLock);
+          if(!error) error = std::current_exception();
+          next = n;
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    for(int iT = 0; iT < std::min(nThreads,int(n)); ++iT)
+      workers.emplace_back(loop);
+    for(auto& worker : workers)
+      worker.join();
+    if(error) std::rethrow_exception(error);
+  }
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// TreeMetadata
+// 
+// Description of a written tree, stored as a TList "metadata" in the UserInfo of the tree so that it
+// travels with it and is read together with the tree header, without looping over the entries.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISTOOLS_UTILITIES_TREEMETADATA_H
+#define ANALYSISTOOLS_UTILITIES_TREEMETADATA_H
+
+#include <iosfwd>
+#include <vector>
+#include <TString.h>
+
+class TTree;
+
+namespace ucsbsusy {
+
+  class TreeMetadata {
+
+    public :
+      TreeMetadata();
+
+      Long64_t		entries;	// entries of the written tree
+      Long64_t		sourceEvents;	// events of the source sample that were processed to write it
+      double		sumWeights;	// of the event weights of the processed events
+      double		sumWeights2;
+      int		process;	// defaults::Process, < 0 if not known
+      double		crossSection;	// in pb, < 0 if not known
+      double		wgtXSec;	// cross section weight per event of the wgtXSec branch, < 0 if not weighted
+      std::vector<TString> sourceFiles;
+      TString		configHash;
+
+      void		addEvent(double weight)	{ sourceEvents++; sumWeights += weight; sumWeights2 += weight*weight;	}
+      // Adds the counts of another part of the same sample, e.g. for a chain or merged files
+      void		add(const TreeMetadata& other);
+      bool		isValid()		  const { return sourceEvents > 0 || entries > 0;	}
+
+      // Replaces the metadata in the UserInfo of the tree, the tree still has to be written
+      void		write(TTree *tree) const;
+      // Returns false if the tree has no metadata
+      bool		read(const TTree *tree);
+
+      void		print(std::ostream& os) const;
+
+  }; // TreeMetadata
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// TreeSchema
+// 
+// Tree variables declared at compile time. Each column is a small struct made with TREE_COLUMN or
+// TREE_MULTICOLUMN, and a TreeSchema<Columns...> stores all of their values in one tuple:
+//
+//   namespace MyColumns { TREE_COLUMN(met, float, 0) TREE_COLUMN(njets, int, 0) TREE_MULTICOLUMN(jetpt, float) }
+//   TreeSchema<MyColumns::met, MyColumns::njets, MyColumns::jetpt> schema;
+//   treeWriterData.attach(&schema);             // booked and reset together with the TreeWriterData
+//   schema.fill<MyColumns::met>(met->pt());     // direct member access, no index or cast
+//
+// Filling a column that is not in the schema, or with a value that is not exactly of its type,
+// does not compile, so narrowing (e.g. double to float) has to be an explicit cast at the call. The leaf type is derived from the C++ type, in the order the columns are listed.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ANALYSISTOOLS_UTILITIES_TREESCHEMA_H
+#define ANALYSISTOOLS_UTILITIES_TREESCHEMA_H
+
+#include <tuple>
+#include <vector>
+#include <type_traits>
+
+#include "AnalysisTools/Utilities/interface/TreeWriter.h"
+
+#define TREE_COLUMN(NAME, TYPE, DEFAULT) \
+  struct NAME { typedef TYPE type; static const char* name() { return #NAME; } static TYPE defaultValue() { return DEFAULT; } };
+#define TREE_MULTICOLUMN(NAME, TYPE) \
+  struct NAME { typedef std::vector<TYPE> type; static const char* name() { return #NAME; } static std::vector<TYPE> defaultValue() { return std::vector<TYPE>(); } };
+
+namespace ucsbsusy {
+
+  // ROOT leaf type codes, only defined for the types a leaf list can hold
+  template<typename Type> struct LeafCode;
+  template<> struct LeafCode<char>               { static const char* code() { return "B"; } };
+  template<> struct LeafCode<unsigned char>      { static const char* code() { return "b"; } };
+  template<> struct LeafCode<short>              { static const char* code() { return "S"; } };
+  template<> struct LeafCode<unsigned short>     { static const char* code() { return "s"; } };
+  template<> struct LeafCode<int>                { static const char* code() { return "I"; } };
+  template<> struct LeafCode<unsigned int>       { static const char* code() { return "i"; } };
+  template<> struct LeafCode<float>              { static const char* code() { return "F"; } };
+  template<> struct LeafCode<double>             { static const char* code() { return "D"; } };
+  template<> struct LeafCode<long long>          { static const char* code() { return "L"; } };
+  template<> struct LeafCode<unsigned long long> { static const char* code() { return "l"; } };
+  template<> struct LeafCode<bool>               { static const char* code() { return "O"; } };
+
+  // Position of Column in Columns..., does not compile if it is not there
+  template<typename Column, typename... Columns> struct ColumnIndex;
+  template<typename Column, typename... Rest>
+  struct ColumnIndex<Column, Column, Rest...> { static const size_t value = 0; };
+  template<typename Column, typename Other, typename... Rest>
+  struct ColumnIndex<Column, Other, Rest...> { static const size_t value = 1 + ColumnIndex<Column, Rest...>::value; };
+  template<typename Column>
+  struct ColumnIndex<Column> { static_assert(sizeof(Column) == 0, "TreeSchema: column is not part of the schema"); };
+
+  // Booked and reset once per event by TreeWriterData, independent of the number of columns
+  class AbstractTreeSchema {
+  public:
+    virtual ~AbstractTreeSchema() {}
+    virtual void book(TreeWriter * tw) = 0;
+    virtual void reset() = 0;
+  };
+
+  template<typename... Columns>
+  class TreeSchema : public AbstractTreeSchema {
+  public:
+    TreeSchema() : values(Columns::defaultValue()...) {}
+
+    template<typename Column>
+    typename Column::type&       get()       { return std::get<ColumnIndex<Column, Columns...>::value>(values); }
+    template<typename Column>
+    const typename Column::type& get() const { return std::get<ColumnIndex<Column, Columns...>::value>(values); }
+
+    template<typename Column, typename FillType>
+    void fill(const FillType& var) {
+      static_assert(std::is_same<typename std::decay<FillType>::type, typename Column::type>::value, "TreeSchema: value is not of the column type, cast it explicitly");
+      get<Column>() = var;
+    }
+    template<typename Column, typename FillType>
+    void fillMulti(const FillType& var) {
+      static_assert(std::is_same<typename std::decay<FillType>::type, typename Column::type::value_type>::value, "TreeSchema: value is not of the column type, cast it explicitly");
+      get<Column>().push_back(var);
+    }
+
+    void book(TreeWriter * tw) {
+      int expand[] = {0, (bookValue(tw, Columns::name(), get<Columns>()), 0)...};
+      (void)expand;
+    }
+    void reset() {
+      int expand[] = {0, (resetValue(get<Columns>(), Columns::defaultValue()), 0)...};
+      (void)expand;
+    }
+
+  protected:
+    template<typename Type>
+    static void bookValue(TreeWriter * tw, const char * name, Type& var) { tw->book(name, var, LeafCode<Type>::code()); }
+    template<typename Type>
+    static void bookValue(TreeWriter * tw, const char * name, std::vector<Type>& var) { tw->book(name, var); }
+
+    template<typename Type>
+    static void resetValue(Type& var, const Type& defaultValue) { var = defaultValue; }
+    template<typename Type>
+    static void resetValue(std::vector<Type>& var, const std::vector<Type>&) { var.clear(); }
+
+    std::tuple<typename Columns::type...> values;
+  };
+
+}
+
+#endif
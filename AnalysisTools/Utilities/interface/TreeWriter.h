@@ -13,15 +13,27 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <assert.h>
 #include <TString.h>
 #include <TTree.h>
 
+#include "AnalysisTools/Utilities/interface/TreeMetadata.h"
+#include "AnalysisTools/Utilities/interface/EventIndex.h"
+
 namespace ucsbsusy {
 
   class TreeWriter {
 
     public :
+      // Compression algorithms, with the same codes as ROOT::ECompressionAlgorithm
+      // LZ4 needs ROOT 6.12 and ZSTD ROOT 6.20, older versions would silently write zlib instead
+      enum Compression { INHERIT = 0, ZLIB = 1, LZMA = 2, LZ4 = 4, ZSTD = 5 };
+      static bool	isSupported(Compression algorithm);
+
       TreeWriter(TTree *tree, const char *treename="Events");
 
       ~TreeWriter();
@@ -32,21 +44,91 @@ namespace ucsbsusy {
       void		setBufSize(Int_t b	)	{ fBufSize = b;		}
       void		setSplitLevel(Int_t s	)	{ fSplitLevel = s;	}
       void		setTreeName(TString n	)	{ fTreeName = n;	fTree->SetName(fTreeName.Data());	}
-      void		fill()				{ fTree->Fill();	}
+      void		fill();
       TTree		*getTree()			{ return fTree;		}
 
+      // Used for the output file and for all branches, including the ones booked later, throws if the algorithm is not supported
+      void		setCompression(Compression algorithm, int level);
+      // Flush a cluster every autoFlush entries (> 0) or bytes (< 0), see TTree::SetAutoFlush
+      // (TTree resizes the baskets from the entry sizes itself when the first cluster is flushed)
+      void		setAutoFlush(Long64_t autoFlush)	{ fTree->SetAutoFlush(autoFlush);	}
+      // Time the fills and print compression and throughput per branch with printReport()
+      void		setReport(bool report = true)	{ fReport = report;	}
+      bool		doReport()			  const { return fReport;	}
+      // Call after the tree is written, so that all baskets are compressed
+      void		printReport() const;
+
+      // Stores the metadata with the tree, with the entries set to the ones filled, call before writing the tree
+      void		writeMetadata(TreeMetadata metadata)	{ finish(); metadata.entries = fTree->GetEntries(); metadata.write(fTree);	}
+      // Writes the index of the written events into the directory of the tree
+      void		writeEventIndex(const EventIndex& index)	{ finish(); index.write(fTree->GetDirectory());	}
+
+      // Asynchronous mode: fill() only copies the booked variables into one of queueDepth slots, and a writer
+      // thread fills the tree from them (and so compresses and flushes the baskets) in the same order.
+      // Has to be called before anything is booked, and only works if all branches are booked through this
+      // class: trees from CloneTree(0) already point to the input buffers, for them the writer stays synchronous.
+      bool		setAsync(int queueDepth = 64);
+      bool		isAsync()			  const { return fAsync;	}
+      // Waits until all queued entries are filled, has to be called before the tree is written
+      void		finish();
+
       template<class T>
-      void		book(const char *name, T& var, const char *type)	{ fTree->Branch(name, &var, TString(name).Append("/").Append(type).Data()); }
+      void		book(const char *name, T& var, const char *type)	{ compress(fTree->Branch(name, &bind(var), TString(name).Append("/").Append(type).Data(), fBufSize)); }
 
       template<class T>
-      void		book(const char *name, std::vector<T>& varv)		{ fTree->Branch(name, &varv);	}
+      void		book(const char *name, std::vector<T>& varv)		{ compress(fTree->Branch(name, &bind(varv), fBufSize, fSplitLevel));	}
 
     protected :
+      // Copy of a booked variable for each queue slot, plus the buffer the branch actually reads from
+      struct AbstractShadow {
+        virtual ~AbstractShadow() {}
+        virtual void	store(size_t slot) = 0;
+        virtual void	load(size_t slot) = 0;
+      };
+      template<class T>
+      struct Shadow : public AbstractShadow {
+        Shadow(const T& v, size_t nSlots) : var(v), value(v), slots(nSlots, v) {}
+        void		store(size_t slot)	{ slots[slot] = var;	}
+        void		load(size_t slot)	{ value = slots[slot];	}
+        const T&	var;
+        T		value;
+        std::vector<T>	slots;
+      };
+
+      template<class T>
+      T&		bind(T& var) {
+        if(!fAsync) return var;
+        assert(!fWriter.joinable());
+        Shadow<T> * shadow = new Shadow<T>(var, fQueueDepth);
+        fShadows.emplace_back(shadow);
+        return shadow->value;
+      }
+
+      void		writeLoop();
+      void		fillTree();
+      void		compress(TBranch *branch) const;
+
       Int_t		fBufSize;
       Int_t		fSplitLevel;
       TString		fTreeName;
       TTree		*fTree;
 
+      int		fCompression;	// ROOT compression settings, < 0 if not set
+      bool		fReport;
+      double		fFillTime;
+
+      bool		fAsync;
+      size_t		fQueueDepth;
+      size_t		fHead;		// entries handed to the queue
+      size_t		fTail;		// entries filled by the writer thread
+      bool		fDone;
+      Long64_t		fNErrors;
+      std::vector<std::unique_ptr<AbstractShadow> >	fShadows;
+      std::thread	fWriter;
+      std::mutex	fLock;
+      std::condition_variable	fNotEmpty;
+      std::condition_variable	fNotFull;
+
   }; // TreeWriter
 
 }
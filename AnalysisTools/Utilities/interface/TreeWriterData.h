@@ -3,9 +3,12 @@
 
 #include <string>
 #include <vector>
+#include <stdexcept>
 #include <assert.h>
 
 #include "AnalysisTools/Utilities/interface/TreeWriter.h"
+#include "AnalysisTools/Utilities/interface/ColumnWriter.h"
+#include "AnalysisTools/Utilities/interface/TreeSchema.h"
 
 namespace ucsbsusy {
 class TreeWriter;
@@ -16,6 +19,9 @@ class TreeWriter;
     virtual ~AbstractTreeVar() {};
     virtual void book(TreeWriter * tw) = 0;
     virtual void reset() = 0;
+    //flat output to a ColumnWriter, the value is repeated for each of the nRows rows
+    virtual void bookColumn(ColumnWriter * cw) = 0;
+    virtual void fillColumn(ColumnWriter * cw, size_t nRows) = 0;
     std::string bookName() const {return prefix == "" ? name : (prefix + "_" + name); }
     const std::string prefix;
     const std::string name;
@@ -31,7 +37,10 @@ class TreeWriter;
     void set(const Type var) {fill(var);}
     void reset() { value = defaultValue;}
     void book(TreeWriter * tw) {tw->book(bookName().c_str(),value,type.c_str());}
+    void bookColumn(ColumnWriter * cw) {column = cw->addColumn<Type>(bookName(),type);}
+    void fillColumn(ColumnWriter * cw, size_t nRows) {cw->fill(column,value,nRows);}
   protected:
+    size_t            column = 0;
     const std::string type;
     const Type        defaultValue;
     Type              value;
@@ -47,6 +56,8 @@ class TreeWriter;
     void set(const std::vector<Type>& vars) {value = vars;}
     void reset() { unsigned int curSize = value.size(); value.resize(0); value.reserve(curSize);}
     void book(TreeWriter * tw) {tw->book(bookName().c_str(),value);}
+    void bookColumn(ColumnWriter * cw) {throw std::invalid_argument("TreeMultiVar: vector variable " + bookName() + " cannot be written as a flat column");}
+    void fillColumn(ColumnWriter * cw, size_t nRows) {}
   protected:
     const Type        defaultValue;
     std::vector<Type> value;
@@ -70,23 +81,32 @@ class TreeWriter;
       return data.size() -1;
     }
 
+    //index based filling, prefer a TreeSchema for new code: the Type is checked only in debug builds
     template<typename Type, typename FillType>
-    void fill(unsigned int index, const FillType var){assert(index < data.size()); ((TreeVar<Type>*)(data[index]))->fill(var);}
+    void fill(unsigned int index, const FillType var){assert(index < data.size()); assert(dynamic_cast<TreeVar<Type>*>(data[index])); static_cast<TreeVar<Type>*>(data[index])->fill(var);}
     template<typename Type>
-    void fill(unsigned int index){ assert(index < data.size()); ((TreeVar<Type>*)(data[index]))->fill();}
+    void fill(unsigned int index){ assert(index < data.size()); assert(dynamic_cast<TreeVar<Type>*>(data[index])); static_cast<TreeVar<Type>*>(data[index])->fill();}
     template<typename Type, typename FillType>
-    void fillMulti(unsigned int index, const FillType var){assert(index < data.size()); ((TreeMultiVar<Type>*)(data[index]))->fill(var);}
+    void fillMulti(unsigned int index, const FillType var){assert(index < data.size()); assert(dynamic_cast<TreeMultiVar<Type>*>(data[index])); static_cast<TreeMultiVar<Type>*>(data[index])->fill(var);}
     template<typename Type>
-    void fillMulti(unsigned int index){assert(index < data.size()); ((TreeMultiVar<Type>*)(data[index]))->fill();}
+    void fillMulti(unsigned int index){assert(index < data.size()); assert(dynamic_cast<TreeMultiVar<Type>*>(data[index])); static_cast<TreeMultiVar<Type>*>(data[index])->fill();}
+
+    //the schema is booked after the indexed variables and reset with them, it is not owned
+    void attach(AbstractTreeSchema * schema){
+      assert(!isBooked);
+      schemas.push_back(schema);
+    }
 
     void book(TreeWriter * tw){
       for(auto d : data) d->book(tw);
+      for(auto s : schemas) s->book(tw);
       isBooked = true;
     }
-    void reset(){ for(auto d : data) d->reset();}
+    void reset(){ for(auto d : data) d->reset(); for(auto s : schemas) s->reset();}
   protected:
     bool isBooked;
     std::vector<AbstractTreeVar*> data;
+    std::vector<AbstractTreeSchema*> schemas;
   };
 }
 
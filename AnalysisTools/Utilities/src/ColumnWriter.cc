@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// ColumnWriter
+// 
+// Writes flat data as a chunked binary column file.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+
+#include "AnalysisTools/Utilities/interface/ColumnWriter.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+ColumnWriter::ColumnWriter(TString fileName, size_t chunkRows) :
+  fFileName(fileName),
+  fChunkRows(chunkRows > 0 ? chunkRows : 1),
+  fChunkFill(0),
+  fNRows(0),
+  fHeaderWritten(false),
+  fOut(fileName.Data(), ios::binary | ios::trunc)
+{
+  if(!fOut) throw std::invalid_argument((TString("ColumnWriter: could not create file: ") + fileName).Data());
+}
+
+ColumnWriter::~ColumnWriter()
+{
+  try {
+    close();
+  } catch (const std::exception& e) {
+    clog << e.what() << endl;
+  }
+}
+
+char *ColumnWriter::grow(size_t column, size_t size, size_t n)
+{
+  assert(column < fColumns.size());
+  Column& col = fColumns[column];
+  if(col.size != size) throw std::invalid_argument(("ColumnWriter: wrong type filled into column " + col.name).c_str());
+  const size_t start = col.data.size();
+  col.data.resize(start + size*n);
+  return col.data.data() + start;
+}
+
+void ColumnWriter::fill(size_t column, const vector<bool>& values)
+{
+  bool * out = (bool*)grow(column, sizeof(bool), values.size());
+  for(size_t i = 0; i < values.size(); ++i) out[i] = values[i];
+}
+
+void ColumnWriter::endBlock(size_t nRows)
+{
+  if(!fHeaderWritten) writeHeader();
+  fChunkFill += nRows;
+  fNRows     += nRows;
+  for(const auto& col : fColumns)
+    if(col.data.size() != fChunkFill*col.size)
+      throw std::invalid_argument(("ColumnWriter: column " + col.name + " does not have the same number of rows as the others").c_str());
+  if(fChunkFill >= fChunkRows) writeChunk();
+}
+
+void ColumnWriter::writeHeader()
+{
+  fOut.write("UCSBCOL1",8);
+  const uint32_t nColumns = fColumns.size();
+  fOut.write((const char*)&nColumns,sizeof(nColumns));
+  for(const auto& col : fColumns){
+    const uint32_t length = col.name.size();
+    const uint32_t size   = col.size;
+    fOut.write((const char*)&length,sizeof(length));
+    fOut.write(col.name.data(),length);
+    fOut.write(&col.type,1);
+    fOut.write((const char*)&size,sizeof(size));
+  }
+  fHeaderWritten = true;
+}
+
+void ColumnWriter::writeChunk()
+{
+  const uint64_t nRows = fChunkFill;
+  fOut.write((const char*)&nRows,sizeof(nRows));
+  for(auto& col : fColumns){
+    fOut.write(col.data.data(),col.data.size());
+    col.data.clear();
+  }
+  fChunkFill = 0;
+}
+
+void ColumnWriter::close()
+{
+  if(!fOut.is_open()) return;
+  if(!fHeaderWritten) writeHeader();
+  if(fChunkFill) writeChunk();
+  const uint64_t end = 0;
+  fOut.write((const char*)&end,sizeof(end));
+  fOut.close();
+  if(fOut.fail()) throw std::runtime_error((TString("ColumnWriter: error writing ") + fFileName).Data());
+}
@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// EventIndex
+// 
+// Set of (run, lumi, event) triples with O(1) insertion and lookup.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include "AnalysisTools/Utilities/interface/EventIndex.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+bool EventIndex::insert(unsigned int run, unsigned int lumi, unsigned int event)
+{
+  if(!fLumis[key(run,lumi)].insert(event).second) return false;
+  fNEvents++;
+  return true;
+}
+
+bool EventIndex::contains(unsigned int run, unsigned int lumi, unsigned int event) const
+{
+  const auto it = fLumis.find(key(run,lumi));
+  return it != fLumis.end() && it->second.count(event);
+}
+
+void EventIndex::write(TDirectory *dir) const
+{
+  TDirectory * current = gDirectory;
+  dir->cd();
+  TTree * tree = new TTree("eventIndex","run, lumi and sorted event numbers of the events in the file");
+  unsigned int run, lumi;
+  vector<unsigned int> events;
+  vector<unsigned int> * eventsPtr = &events;
+  tree->Branch("run",&run,"run/i");
+  tree->Branch("lumi",&lumi,"lumi/i");
+  tree->Branch("events",&eventsPtr);
+
+  //sorted so that the file does not depend on the hashing, and the event numbers compress well
+  vector<unsigned long long> keys;
+  keys.reserve(fLumis.size());
+  for(const auto& lumiEvents : fLumis) keys.push_back(lumiEvents.first);
+  sort(keys.begin(),keys.end());
+  for(auto k : keys){
+    run  = k >> 32;
+    lumi = k & 0xffffffff;
+    const auto& lumiEvents = fLumis.find(k)->second;
+    events.assign(lumiEvents.begin(),lumiEvents.end());
+    sort(events.begin(),events.end());
+    tree->Fill();
+  }
+  tree->Write(0,TObject::kOverwrite);
+  delete tree;
+  current->cd();
+}
+
+bool EventIndex::read(const TString& fileName)
+{
+  TFile * file = TFile::Open(fileName,"READ");
+  if(!file || file->IsZombie()) throw std::invalid_argument((TString("EventIndex: could not open file: ") + fileName).Data());
+  TTree * tree = 0;
+  file->GetObject("eventIndex",tree);
+  if(!tree){
+    delete file;
+    return false;
+  }
+  unsigned int run, lumi;
+  vector<unsigned int> * events = 0;
+  tree->SetBranchAddress("run",&run);
+  tree->SetBranchAddress("lumi",&lumi);
+  tree->SetBranchAddress("events",&events);
+  for(Long64_t iE = 0; iE < tree->GetEntries(); ++iE){
+    tree->GetEntry(iE);
+    for(auto event : *events) insert(run,lumi,event);
+  }
+  delete events;
+  delete file;
+  return true;
+}
@@ -0,0 +1,40 @@
+/*
+ * FileFingerprint.cc
+ */
+
+#include <stdexcept>
+#include <memory>
+#include <TFile.h>
+#include <TTree.h>
+#include <TMD5.h>
+
+#include "AnalysisTools/Utilities/interface/FileFingerprint.h"
+
+//_____________________________________________________________________________
+TString FileFingerprint::get(const TFile* file)
+{
+  if(!file) throw std::invalid_argument("FileFingerprint::get(): no file given!");
+  return TString::Format("%s:%lld:%s",file->GetUUID().AsString(),file->GetSize(),file->GetModificationDate().AsSQLString());
+}
+//_____________________________________________________________________________
+TString FileFingerprint::get(const TTree* tree)
+{
+  if(!tree) throw std::invalid_argument("FileFingerprint::get(): no tree given!");
+  const TFile * file = tree->GetCurrentFile();
+  return TString::Format("%s:%s:%lld",file ? get(file).Data() : "",tree->GetName(),tree->GetEntries());
+}
+//_____________________________________________________________________________
+TString FileFingerprint::get(const TString& fileName)
+{
+  std::unique_ptr<TFile> file(TFile::Open(fileName,"READ"));
+  if(!file || file->IsZombie()) throw std::invalid_argument((TString("FileFingerprint::get(): could not open file: ") + fileName).Data());
+  return get(file.get());
+}
+//_____________________________________________________________________________
+TString FileFingerprint::hash(const TString& str)
+{
+  TMD5 md5;
+  md5.Update((const UChar_t*)str.Data(),str.Length());
+  md5.Final();
+  return md5.AsString();
+}
@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// LumiMask
+// 
+// Certified luminosity sections from a CMS JSON file.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "AnalysisTools/Utilities/interface/LumiMask.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+namespace {
+  // Minimal reader for the fixed layout of the lumi JSON files
+  class Parser {
+  public:
+    Parser(const string& text, const TString& fileName) : text_(text), pos_(0), fileName_(fileName) {}
+    void expect(char c) {
+      skip();
+      if(pos_ >= text_.size() || text_[pos_] != c) fail(TString::Format("expected '%c'",c));
+      pos_++;
+    }
+    bool accept(char c) {
+      skip();
+      if(pos_ < text_.size() && text_[pos_] == c){ pos_++; return true; }
+      return false;
+    }
+    unsigned int number(bool quoted) {
+      if(quoted) expect('"');
+      skip();
+      if(pos_ >= text_.size() || !isdigit(text_[pos_])) fail("expected a number");
+      unsigned long value = 0;
+      while(pos_ < text_.size() && isdigit(text_[pos_])) value = 10*value + (text_[pos_++] - '0');
+      if(quoted) expect('"');
+      return value;
+    }
+  private:
+    void skip() { while(pos_ < text_.size() && isspace(text_[pos_])) pos_++; }
+    void fail(const TString& what) const {
+      throw std::invalid_argument(TString::Format("LumiMask: error parsing %s at character %lu: %s",fileName_.Data(),(unsigned long)pos_,what.Data()).Data());
+    }
+    const string& text_;
+    size_t        pos_;
+    TString       fileName_;
+  };
+}
+
+LumiMask::LumiMask(const TString& jsonFile)
+{
+  ifstream file(jsonFile.Data());
+  if(!file) throw std::invalid_argument((TString("LumiMask: could not open ") + jsonFile).Data());
+  stringstream buffer;
+  buffer << file.rdbuf();
+  const string text = buffer.str();
+
+  Parser parser(text,jsonFile);
+  parser.expect('{');
+  if(parser.accept('}')) return;
+  do {
+    const unsigned int run = parser.number(true);
+    parser.expect(':');
+    parser.expect('[');
+    vector<bool>& lumis = fRuns[run];
+    if(!parser.accept(']')){
+      do {
+        parser.expect('[');
+        const unsigned int first = parser.number(false);
+        parser.expect(',');
+        const unsigned int last  = parser.number(false);
+        parser.expect(']');
+        if(last >= lumis.size()) lumis.resize(last + 1,false);
+        for(unsigned int lumi = first; lumi <= last; ++lumi) lumis[lumi] = true;
+      } while(parser.accept(','));
+      parser.expect(']');
+    }
+  } while(parser.accept(','));
+  parser.expect('}');
+}
+
+size_t LumiMask::getNLumis() const
+{
+  size_t nLumis = 0;
+  for(const auto& run : fRuns)
+    for(bool certified : run.second) nLumis += certified;
+  return nLumis;
+}
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------------------------------
+// 
+// TreeMetadata
+// 
+// Description of a written tree, stored in the UserInfo of the tree.
+// 
+//--------------------------------------------------------------------------------------------------
+
+#include <iostream>
+#include <TTree.h>
+#include <TList.h>
+#include <TParameter.h>
+#include <TObjString.h>
+#include <TNamed.h>
+
+#include "AnalysisTools/Utilities/interface/TreeMetadata.h"
+
+using namespace std;
+using namespace ucsbsusy;
+
+namespace {
+  template<typename Type>
+  Type getParameter(const TList * list, const char * name, Type defaultValue)
+  {
+    const TParameter<Type> * par = dynamic_cast<const TParameter<Type>*>(list->FindObject(name));
+    return par ? par->GetVal() : defaultValue;
+  }
+}
+
+TreeMetadata::TreeMetadata() :
+  entries(0),
+  sourceEvents(0),
+  sumWeights(0),
+  sumWeights2(0),
+  process(-1),
+  crossSection(-1),
+  wgtXSec(-1)
+{}
+
+void TreeMetadata::add(const TreeMetadata& other)
+{
+  entries      += other.entries;
+  sourceEvents += other.sourceEvents;
+  sumWeights   += other.sumWeights;
+  sumWeights2  += other.sumWeights2;
+  if(process < 0)      process      = other.process;
+  if(crossSection < 0) crossSection = other.crossSection;
+  if(wgtXSec < 0)      wgtXSec      = other.wgtXSec;
+  if(configHash == "") configHash   = other.configHash;
+  sourceFiles.insert(sourceFiles.end(),other.sourceFiles.begin(),other.sourceFiles.end());
+}
+
+void TreeMetadata::write(TTree *tree) const
+{
+  TList * userInfo = tree->GetUserInfo();
+  if(TObject * old = userInfo->FindObject("metadata")){
+    userInfo->Remove(old);
+    delete old;
+  }
+
+  TList * list = new TList();
+  list->SetName("metadata");
+  list->SetOwner();
+  list->Add(new TParameter<Long64_t>("entries",entries));
+  list->Add(new TParameter<Long64_t>("sourceEvents",sourceEvents));
+  list->Add(new TParameter<double>("sumWeights",sumWeights));
+  list->Add(new TParameter<double>("sumWeights2",sumWeights2));
+  list->Add(new TParameter<int>("process",process));
+  list->Add(new TParameter<double>("crossSection",crossSection));
+  list->Add(new TParameter<double>("wgtXSec",wgtXSec));
+  list->Add(new TNamed("configHash",configHash.Data()));
+  TList * files = new TList();
+  files->SetName("sourceFiles");
+  files->SetOwner();
+  for(const auto& name : sourceFiles) files->Add(new TObjString(name));
+  list->Add(files);
+  userInfo->Add(list);
+}
+
+bool TreeMetadata::read(const TTree *tree)
+{
+  *this = TreeMetadata();
+  const TList * list = dynamic_cast<const TList*>(const_cast<TTree*>(tree)->GetUserInfo()->FindObject("metadata"));
+  if(!list) return false;
+
+  entries      = getParameter<Long64_t>(list,"entries",0);
+  sourceEvents = getParameter<Long64_t>(list,"sourceEvents",0);
+  sumWeights   = getParameter<double>(list,"sumWeights",0);
+  sumWeights2  = getParameter<double>(list,"sumWeights2",0);
+  process      = getParameter<int>(list,"process",-1);
+  crossSection = getParameter<double>(list,"crossSection",-1);
+  wgtXSec      = getParameter<double>(list,"wgtXSec",-1);
+  if(const TNamed * hash = dynamic_cast<const TNamed*>(list->FindObject("configHash"))) configHash = hash->GetTitle();
+  if(const TList * files = dynamic_cast<const TList*>(list->FindObject("sourceFiles"))){
+    TIter nextFile(files);
+    while(TObject * obj = nextFile()) sourceFiles.push_back(((TObjString*)obj)->GetString());
+  }
+  return true;
+}
+
+void TreeMetadata::print(std::ostream& os) const
+{
+  os << "entries = " << entries << ", source events = " << sourceEvents << ", sum of weights = " << sumWeights
+     << " (sum of squares " << sumWeights2 << "), process = " << process << ", cross section = " << crossSection
+     << " pb, wgtXSec = " << wgtXSec << ", " << sourceFiles.size() << " source files, config " << (configHash == "" ? TString("-") : configHash) << endl;
+}
@@ -8,20 +8,162 @@
 // 
 //--------------------------------------------------------------------------------------------------
 
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <RVersion.h>
+#include <TROOT.h>
+#include <TFile.h>
+
 #include "AnalysisTools/Utilities/interface/TreeWriter.h"
 
+using namespace std;
 using namespace ucsbsusy;
 
 TreeWriter::TreeWriter(TTree *tree, const char *treename) :
   fBufSize(32000),
   fSplitLevel(99),
   fTreeName(treename),
-  fTree(tree)
+  fTree(tree),
+  fCompression(-1),
+  fReport(false),
+  fFillTime(0),
+  fAsync(false),
+  fQueueDepth(0),
+  fHead(0),
+  fTail(0),
+  fDone(false),
+  fNErrors(0)
 {
   fTree->SetName(fTreeName.Data());
 }
 
 TreeWriter::~TreeWriter()
 {
+  finish();
   delete fTree;
 }
+
+bool TreeWriter::isSupported(Compression algorithm)
+{
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,12,0)
+  if(algorithm == LZ4) return false;
+#endif
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,20,0)
+  if(algorithm == ZSTD) return false;
+#endif
+  return true;
+}
+
+void TreeWriter::setCompression(Compression algorithm, int level)
+{
+  assert(level >= 0 && level <= 9);
+  if(!isSupported(algorithm))
+    throw std::invalid_argument(TString::Format("TreeWriter::setCompression: algorithm %i is not supported by ROOT %s",int(algorithm),ROOT_RELEASE).Data());
+  fCompression = 100*algorithm + level;
+  if(fTree->GetCurrentFile()) fTree->GetCurrentFile()->SetCompressionSettings(fCompression);
+  //branches take the settings of the file when they are created, cloned ones have to be updated
+  TIter next(fTree->GetListOfBranches());
+  while(TBranch * branch = (TBranch*)next()) compress(branch);
+}
+
+void TreeWriter::compress(TBranch *branch) const
+{
+  if(fCompression < 0 || !branch) return;
+  branch->SetCompressionSettings(fCompression);
+  TIter next(branch->GetListOfBranches());
+  while(TBranch * sub = (TBranch*)next()) compress(sub);
+}
+
+void TreeWriter::fillTree()
+{
+  const auto start = fReport ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+  if(fTree->Fill() < 0) ++fNErrors;
+  if(fReport) fFillTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void TreeWriter::printReport() const
+{
+  const double MB = 1024.*1024.;
+  const double time = fFillTime > 0 ? fFillTime : 1e-9;
+  clog << "TreeWriter: " << fTreeName << " with " << fTree->GetEntries() << " entries, " << fTree->GetListOfBranches()->GetEntries()
+       << " branches, compression settings " << (fCompression < 0 ? (fTree->GetCurrentFile() ? fTree->GetCurrentFile()->GetCompressionSettings() : 0) : fCompression)
+       << ", " << TString::Format("%.2f",fFillTime) << " s in TTree::Fill" << endl;
+  clog << TString::Format("%-30s %12s %12s %8s %12s","branch","MB","zipped MB","ratio","MB/s") << endl;
+  TIter next(fTree->GetListOfBranches());
+  while(TBranch * branch = (TBranch*)next()){
+    const double tot = branch->GetTotBytes("*")/MB;
+    const double zip = branch->GetZipBytes("*")/MB;
+    clog << TString::Format("%-30s %12.3f %12.3f %8.2f %12.2f",branch->GetName(),tot,zip,zip > 0 ? tot/zip : 0.,tot/time) << endl;
+  }
+  const double tot = fTree->GetTotBytes()/MB;
+  const double zip = fTree->GetZipBytes()/MB;
+  clog << TString::Format("%-30s %12.3f %12.3f %8.2f %12.2f","total",tot,zip,zip > 0 ? tot/zip : 0.,tot/time) << endl;
+}
+
+bool TreeWriter::setAsync(int queueDepth)
+{
+  assert(queueDepth > 0);
+  if(fAsync) return true;
+  if(fTree->GetListOfBranches()->GetEntries()){
+    clog << "TreeWriter: " << fTreeName << " already has branches that are not booked through TreeWriter, filling it synchronously" << endl;
+    return false;
+  }
+  //the writer thread fills while the event loop reads, ROOT has to lock its internals
+  ROOT::EnableThreadSafety();
+  fAsync      = true;
+  fQueueDepth = queueDepth;
+  return true;
+}
+
+void TreeWriter::fill()
+{
+  if(!fAsync){ fillTree(); return; }
+  if(!fWriter.joinable()) fWriter = thread(&TreeWriter::writeLoop,this);
+
+  unique_lock<mutex> lock(fLock);
+  fNotFull.wait(lock,[this]{ return fHead - fTail < fQueueDepth; });
+  const size_t slot = fHead % fQueueDepth;
+  lock.unlock();
+
+  //the writer thread does not touch this slot before fHead moves past it
+  for(const auto& shadow : fShadows) shadow->store(slot);
+
+  lock.lock();
+  ++fHead;
+  lock.unlock();
+  fNotEmpty.notify_one();
+}
+
+void TreeWriter::writeLoop()
+{
+  unique_lock<mutex> lock(fLock);
+  while(true){
+    fNotEmpty.wait(lock,[this]{ return fTail < fHead || fDone; });
+    if(fTail == fHead) break;
+    const size_t slot = fTail % fQueueDepth;
+    lock.unlock();
+
+    for(const auto& shadow : fShadows) shadow->load(slot);
+    fillTree();
+
+    lock.lock();
+    ++fTail;
+    fNotFull.notify_one();
+  }
+}
+
+void TreeWriter::finish()
+{
+  if(fWriter.joinable()){
+    {
+      lock_guard<mutex> lock(fLock);
+      fDone = true;
+    }
+    fNotEmpty.notify_one();
+    fWriter.join();
+    fDone = false;
+  }
+  if(fNErrors) clog << "TreeWriter: " << fNErrors << " entries of " << fTreeName << " could not be written!" << endl;
+  fNErrors = 0;
+}